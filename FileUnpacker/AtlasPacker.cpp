@@ -0,0 +1,186 @@
+// AtlasPacker.cpp : MaxRects rectangle packer used to lay out spritesheets.
+//
+// Free space of a page is kept as a list of maximal free rectangles, which may overlap.
+// Each placement splits every free rectangle it touches into the (up to four) parts
+// left around it, then free rectangles contained in another one are dropped.
+
+#include "headers/AtlasPacker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace {
+
+struct FreeRect {
+    uint32_t x, y, width, height;
+};
+
+class MaxRectsBin {
+public:
+    MaxRectsBin(uint32_t width, uint32_t height) {
+        freeRects.push_back({ 0, 0, width, height });
+    }
+
+    // Places a rectangle, false if there's no room left for it
+    bool insert(uint32_t width, uint32_t height, uint32_t& x, uint32_t& y) {
+        uint32_t bestShortSide = std::numeric_limits<uint32_t>::max();
+        uint32_t bestLongSide = std::numeric_limits<uint32_t>::max();
+        const FreeRect* best = nullptr;
+
+        for (const FreeRect& free : freeRects) {
+            if (free.width < width || free.height < height)
+                continue;
+
+            uint32_t leftoverX = free.width - width;
+            uint32_t leftoverY = free.height - height;
+            uint32_t shortSide = std::min(leftoverX, leftoverY);
+            uint32_t longSide = std::max(leftoverX, leftoverY);
+            if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide)) {
+                best = &free;
+                bestShortSide = shortSide;
+                bestLongSide = longSide;
+            }
+        }
+
+        if (!best)
+            return false;
+
+        x = best->x;
+        y = best->y;
+        place({ x, y, width, height });
+        return true;
+    }
+
+private:
+    void place(const FreeRect& used) {
+        std::vector<FreeRect> next;
+        next.reserve(freeRects.size() + 4);
+
+        for (const FreeRect& free : freeRects) {
+            bool overlaps = used.x < free.x + free.width && used.x + used.width > free.x &&
+                used.y < free.y + free.height && used.y + used.height > free.y;
+            if (!overlaps) {
+                next.push_back(free);
+                continue;
+            }
+
+            // Left, right, top and bottom parts of the free rectangle that the placement doesn't cover
+            if (used.x > free.x)
+                next.push_back({ free.x, free.y, used.x - free.x, free.height });
+            if (used.x + used.width < free.x + free.width)
+                next.push_back({ used.x + used.width, free.y, free.x + free.width - (used.x + used.width), free.height });
+            if (used.y > free.y)
+                next.push_back({ free.x, free.y, free.width, used.y - free.y });
+            if (used.y + used.height < free.y + free.height)
+                next.push_back({ free.x, used.y + used.height, free.width, free.y + free.height - (used.y + used.height) });
+        }
+
+        freeRects.clear();
+        for (size_t i = 0; i < next.size(); ++i) {
+            bool contained = false;
+            for (size_t j = 0; j < next.size() && !contained; ++j) {
+                if (i == j)
+                    continue;
+                const FreeRect& a = next[i];
+                const FreeRect& b = next[j];
+                bool inside = a.x >= b.x && a.y >= b.y &&
+                    a.x + a.width <= b.x + b.width && a.y + a.height <= b.y + b.height;
+                // Of two identical rectangles keep the first
+                bool identical = a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+                contained = inside && (!identical || j < i);
+            }
+            if (!contained)
+                freeRects.push_back(next[i]);
+        }
+    }
+
+    std::vector<FreeRect> freeRects;
+};
+
+// Packs the rectangles in order into one side x side page, returns how many fit before the first one that didn't
+size_t packPage(std::vector<AtlasRect>& rects, const std::vector<size_t>& order, size_t first, uint32_t side, bool stopAtFirstMiss, std::vector<size_t>& placed) {
+    MaxRectsBin bin(side, side);
+    placed.clear();
+
+    for (size_t i = first; i < order.size(); ++i) {
+        AtlasRect& rect = rects[order[i]];
+        if (bin.insert(rect.width, rect.height, rect.x, rect.y)) {
+            placed.push_back(order[i]);
+        }
+        else if (stopAtFirstMiss) {
+            break;
+        }
+    }
+    return placed.size();
+}
+
+} // namespace
+
+bool packAtlas(std::vector<AtlasRect>& rects, uint32_t maxPageSize, std::vector<AtlasPage>& pages) {
+    pages.clear();
+
+    // Tallest first, then widest, ties keep frame order so the layout is stable
+    std::vector<size_t> order;
+    for (size_t i = 0; i < rects.size(); ++i) {
+        rects[i].x = 0;
+        rects[i].y = 0;
+        rects[i].page = 0;
+        if (rects[i].width == 0 || rects[i].height == 0)
+            continue;
+        if (rects[i].width > maxPageSize || rects[i].height > maxPageSize)
+            return false;
+        order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (rects[a].height != rects[b].height)
+            return rects[a].height > rects[b].height;
+        return rects[a].width > rects[b].width;
+    });
+
+    std::vector<size_t> placed;
+    std::vector<bool> done(rects.size(), false);
+    std::vector<size_t> remaining = order;
+
+    while (!remaining.empty()) {
+        // Smallest square the remaining area could fit in, grown until everything fits or the page is full
+        uint64_t area = 0;
+        uint32_t side = 0;
+        for (size_t index : remaining) {
+            area += static_cast<uint64_t>(rects[index].width) * rects[index].height;
+            side = std::max({ side, rects[index].width, rects[index].height });
+        }
+        side = std::max(side, static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(area)))));
+        side = std::min(side, maxPageSize);
+
+        while (side < maxPageSize && packPage(rects, remaining, 0, side, true, placed) < remaining.size()) {
+            side = std::min(maxPageSize, side + std::max<uint32_t>(side / 16, 1));
+        }
+        if (side == maxPageSize) {
+            // Full size page, take whatever fits and leave the rest for the next page
+            packPage(rects, remaining, 0, side, false, placed);
+        }
+
+        AtlasPage page;
+        for (size_t index : placed) {
+            rects[index].page = static_cast<uint32_t>(pages.size());
+            page.width = std::max(page.width, rects[index].x + rects[index].width);
+            page.height = std::max(page.height, rects[index].y + rects[index].height);
+            done[index] = true;
+        }
+        pages.push_back(page);
+
+        std::vector<size_t> left;
+        for (size_t index : remaining) {
+            if (!done[index])
+                left.push_back(index);
+        }
+        remaining.swap(left);
+    }
+
+    if (pages.empty()) {
+        pages.push_back(AtlasPage());
+    }
+    return true;
+}
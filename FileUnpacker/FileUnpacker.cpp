@@ -2,6 +2,19 @@
 //
 
 #include "FileUnpacker.h"
+#include "headers/SignatureScanner.h"
+#include "headers/InputSource.h"
+#include "headers/Hash.h"
+#include "headers/ResourceIndex.h"
+#include "headers/OutputManifest.h"
+#include "headers/PixelConversion.h"
+#include "headers/AtlasPacker.h"
+#include "headers/FrameStore.h"
+#include "headers/ThreadPool.h"
+#include "headers/OutputWriter.h"
+#include "headers/Pipeline.h"
+#include "headers/ResourceViews.h"
+#include "headers/PaletteDatabase.h"
 
 using namespace std;
 #include <iostream>
@@ -15,6 +28,16 @@ using namespace std;
 #include <limits>
 #include <map>
 #include <cmath>
+#include <sstream>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <functional>
+#include <charconv>
+#include <cctype>
+#include <set>
+#include <optional>
 
 #pragma pack(push, 1)
 struct BMPHeader {
@@ -45,15 +68,103 @@ enum class FileFormat {
     D3GR
 };
 
+// Pixel layout of the BMP files written for D3GR frames
+enum class BitmapMode {
+    TrueColor,  // 24-bit BGR, every index looked up in the palette
+    Indexed     // 8-bit indices with the palette as the color table, rows copied as they are
+};
+
+// What one extraction run produced, filled in when it finishes
+struct RunStats {
+    uint64_t resources = 0;     // Including the ones skipped because their outputs were current
+    uint64_t frames = 0;
+};
+
+// Settings shared by every format handler during one extraction run
+struct ExtractionOptions {
+    bool extractIndividualFrames = true;
+    bool extractSpritesheet = false;
+    BitmapMode bitmapMode = BitmapMode::TrueColor;
+    uint32_t atlasMaxPageSize = 8192;   // Largest spritesheet page, frames that don't fit go on more pages
+    bool trimFrames = false;            // Leave out the transparent border of frames, offsets go in the JSON metadata
+    bool exportRawResources = true;     // Write the raw copy of every resource, off when only the frames are wanted
+
+    // Frames written so far, identical frames are hard linked to the first copy instead of being
+    // written again. Share one store between runs to catch duplicates across archives, null turns it off.
+    // Of identical frames the one of the archive with the lowest archiveRank (see FrameStore::reserveArchives),
+    // then the lowest resource and frame index is the copy, the others are links to it.
+    FrameStore* frameStore = nullptr;
+    uint32_t archiveRank = 0;
+
+    // Frames of streamed resources, the pipeline stages of mapped archives (see runExtractionPipeline) and the
+    // archives of a batch run on a thread pool. Each run makes its own with workerThreads threads (0 uses every
+    // hardware thread) unless pool is set, then that one is shared.
+    unsigned workerThreads = 0;
+    ThreadPool* pool = nullptr;
+
+    // Tasks each stage of a mapped archive runs at once on the pool (see runExtractionPipeline), 0 lets the
+    // stage use every thread of the pool. Scanning uses scanThreads and writing the writer's own threads.
+    unsigned parseThreads = 1;
+    unsigned decodeThreads = 0;
+    unsigned encodeThreads = 0;
+
+    // Finished files are handed to a background writer (io_uring where the kernel has it) so conversion
+    // doesn't wait on the disk. Each run makes its own unless writer is set, then that one is shared.
+    OutputWriter* writer = nullptr;
+    unsigned writerThreads = 2;                  // Threads of the writer when io_uring isn't available
+    size_t writeBufferLimit = size_t(64) << 20;  // Bytes of encoded files allowed to wait for the disk
+
+    // Pack mode puts everything a run extracts into one indexed pack file (headers/PackFile.h) under the
+    // paths it would have on disk, instead of creating the directories and thousands of small files.
+    // A pack always gets a writer of its own, and duplicate frames are only linked within it.
+    bool packOutput = false;
+    std::string packPath;   // <archive>.pack in the working directory when empty, batch runs always use that
+
+    // Progress messages, batch runs give every archive its own buffer
+    std::ostream* log = &std::cout;
+
+    // Colors of the frames (256 * 3 bytes, grayscale when empty), usually pointing into palettes. Whatever it
+    // points to has to outlive the run. Batch runs switch to the palette palettes maps each archive to.
+    std::span<const uint8_t> palette;
+    const PaletteDatabase* palettes = nullptr;
+
+    // Streaming mode reads the archive through a bounded window instead of mapping it.
+    // It's also used automatically for inputs that can't be mapped (pipes, "-" for stdin).
+    bool streaming = false;
+    size_t streamWindowSize = size_t(16) << 20;  // Bytes read from the input at a time
+    size_t memoryLimit = size_t(256) << 20;      // Largest resource held in memory for its content handler
+
+    // Threads scanning a mapped archive for signatures, 0 uses every hardware thread
+    unsigned scanThreads = 0;
+
+    // Table of contents sidecar (<archive>.<formats>.toc): reuse it when it's current, write it after a scan
+    bool useIndex = true;
+    bool writeIndex = true;
+
+    // Output manifest (<output folder>/.manifest) of mapped archives: skip resources whose outputs are still
+    // current, record what was written after a run. Packs are always written whole and have none.
+    bool useManifest = true;
+    bool writeManifest = true;
+
+    // Counts of the run are stored here when it's set
+    RunStats* stats = nullptr;
+};
+
 struct FormatInfo {
     std::string name;
     std::string extension;
     std::string folderName;
-};
-
-const std::map<FileFormat, FormatInfo> formatInfoMap = {
-    {FileFormat::WAV, {"WAV Audio", "wav", "extracted_wav"}},
-    {FileFormat::D3GR, {"D3GR (Sanitarium Graphic Resource file)", "d3gr", "extracted_gr"}}
+    SignaturePattern signature;
+    // Size of the resource starting at header, which holds at least getHeaderSize bytes.
+    // 0 rejects the header as a stray signature before any output work is done.
+    uint32_t(*getSize)(std::span<const std::byte> header);
+    // Bytes getSize reads, given what's available so far (streaming loads more until they fit)
+    size_t(*getHeaderSize)(std::span<const std::byte> available);
+    // Optional, records the frame table of the resource for the index
+    void(*indexFrames)(std::span<const std::byte> resource, std::vector<IndexedFrame>& frames);
+    // Optional extra work after the raw resource is written, returns the number of frames extracted
+    // Resources can be extracted concurrently, so progress goes to log rather than straight to std::cout
+    int(*extractContents)(std::span<const std::byte> resource, const std::string& subfolder, int resourceIndex, const ExtractionOptions& options, const PaletteLUT& paletteLUT, std::ostream& log);
 };
 
 void printHexBuffer(const char* data, size_t size, size_t position) {
@@ -65,638 +176,33 @@ void printHexBuffer(const char* data, size_t size, size_t position) {
     std::cout << std::dec << std::endl;
 }
 
-// Extract WAV file size from header
-uint32_t getWavSize(const char* data) {
-    // WAV file size is at bytes 4-7 (little endian) + 8 bytes for header
-    uint32_t size = static_cast<uint8_t>(data[4]) |
-        (static_cast<uint8_t>(data[5]) << 8) |
-        (static_cast<uint8_t>(data[6]) << 16) |
-        (static_cast<uint8_t>(data[7]) << 24);
-    return size + 8;
-}
-
-uint32_t getGraphicsResourceSize(const char* data) {
-    // Frame count is at offset 0x18 (2-byte little endian)
-    uint16_t frameCount = static_cast<uint16_t>(
-        static_cast<uint8_t>(data[0x18]) |
-        (static_cast<uint8_t>(data[0x19]) << 8)
-        );
-
-    uint32_t offsetsEndPosition = 0x1C + (frameCount * 4);
-    uint32_t lastFrameOffset = 0;
-    size_t lastOffsetPos = 0x1C + ((frameCount - 1) * 4);
-
-    lastFrameOffset = static_cast<uint8_t>(data[lastOffsetPos]) |
-        (static_cast<uint8_t>(data[lastOffsetPos + 1]) << 8) |
-        (static_cast<uint8_t>(data[lastOffsetPos + 2]) << 16) |
-        (static_cast<uint8_t>(data[lastOffsetPos + 3]) << 24);
-
-    uint32_t lastFramePosition = offsetsEndPosition + lastFrameOffset;
-    uint16_t lastFrameWidth = static_cast<uint16_t>(
-        static_cast<uint8_t>(data[lastFramePosition + 0x0E]) |
-        (static_cast<uint8_t>(data[lastFramePosition + 0x0E + 1]) << 8)
-        );
-
-    uint16_t lastFrameHeight = static_cast<uint16_t>(
-        static_cast<uint8_t>(data[lastFramePosition + 0x0C]) |
-        (static_cast<uint8_t>(data[lastFramePosition + 0x0C + 1]) << 8)
-        );
-
-    // frame's data
-    uint32_t lastFrameDataSize = lastFrameWidth * lastFrameHeight;
-    // Total size is the position of the last frame + its header (0x10) + its data size
-    uint32_t totalSize = lastFramePosition + 0x10 + lastFrameDataSize;
-    return totalSize;
-}
-
-// Function to search for WAV header pattern
-size_t findWavHeader(const char* buffer, size_t bufferSize) {
-    // Look for the pattern RIFF____WAVEfmt (where ____ is any 4 bytes)
-    for (size_t i = 0; i <= bufferSize - 12; ++i) {
-        if ((unsigned char)buffer[i] == 0x52 && // 'R'
-            (unsigned char)buffer[i + 1] == 0x49 && // 'I'
-            (unsigned char)buffer[i + 2] == 0x46 && // 'F'
-            (unsigned char)buffer[i + 3] == 0x46 && // 'F'
-            // Skip size bytes (4-7)
-            (unsigned char)buffer[i + 8] == 0x57 && // 'W'
-            (unsigned char)buffer[i + 9] == 0x41 && // 'A'
-            (unsigned char)buffer[i + 10] == 0x56 && // 'V'
-            (unsigned char)buffer[i + 11] == 0x45) { // 'E'
-            return i;
-        }
-    }
-    return SIZE_MAX; // Not found
-}
-
-size_t findGraphicsResourceHeader(const char* buffer, size_t bufferSize) {
-    // Signature is D3GR
-    for (size_t i = 0; i <= bufferSize - 4; ++i) {
-        if (buffer[i] == 'D' &&
-            buffer[i + 1] == '3' &&
-            buffer[i + 2] == 'G' &&
-            buffer[i + 3] == 'R') {
-            return i;
-        }
-    }
-    return SIZE_MAX; // Not found
-}
-
-// TODO: move the palettes to a separate file and read them from there
-// For now they're going to live here until I can find all of them and map them correctly
-uint8_t paletteDataRes006[256][4] = {
-    {0x00, 0x00, 0x00, 0xFF}, // 0
-    {0xFC, 0xFC, 0xFC, 0xFF}, // 1
-    {0xFC, 0xF4, 0xC4, 0xFF}, // 2
-    {0xD4, 0xFC, 0xFC, 0xFF}, // 3
-    {0xFC, 0xF4, 0x94, 0xFF}, // 4
-    {0xE8, 0xE8, 0xE8, 0xFF}, // 5
-    {0xE8, 0xE0, 0xFC, 0xFF}, // 6
-    {0xFC, 0xF0, 0x1C, 0xFF}, // 7
-    {0xFC, 0xF0, 0x18, 0xFF}, // 8
-    {0xB8, 0xE0, 0xFC, 0xFF}, // 9
-    {0xD4, 0xD4, 0xD4, 0xFF}, // 10
-    {0xA8, 0xE4, 0xFC, 0xFF}, // 11
-    {0xEC, 0xD0, 0xA0, 0xFF}, // 12
-    {0xB8, 0xF0, 0x8C, 0xFF}, // 13
-    {0xE4, 0xDC, 0x58, 0xFF}, // 14
-    {0xD0, 0xD0, 0xD0, 0xFF}, // 15
-    {0xB0, 0xE4, 0x84, 0xFF}, // 16
-    {0xC4, 0xC4, 0xC4, 0xFF}, // 17
-    {0xE0, 0xD0, 0x1C, 0xFF}, // 18
-    {0xE8, 0xC8, 0x2C, 0xFF}, // 19
-    {0xEC, 0xC8, 0x1C, 0xFF}, // 20
-    {0xE4, 0xB8, 0x80, 0xFF}, // 21
-    {0xC8, 0xB8, 0xB4, 0xFF}, // 22
-    {0xA8, 0xD4, 0x74, 0xFF}, // 23
-    {0xE0, 0xAC, 0x94, 0xFF}, // 24
-    {0x9C, 0xD0, 0x70, 0xFF}, // 25
-    {0xC4, 0xAC, 0xA4, 0xFF}, // 26
-    {0xB8, 0xB8, 0xB8, 0xFF}, // 27
-    {0x80, 0xBC, 0xFC, 0xFF}, // 28
-    {0xC4, 0xA8, 0x9C, 0xFF}, // 29
-    {0xC0, 0xBC, 0x34, 0xFF}, // 30
-    {0xCC, 0x9C, 0x84, 0xFF}, // 31
-    {0xD4, 0xAC, 0x1C, 0xFF}, // 32
-    {0xDC, 0xA8, 0x28, 0xFF}, // 33
-    {0xDC, 0xA4, 0x24, 0xFF}, // 34
-    {0x8C, 0xC0, 0x64, 0xFF}, // 35
-    {0xD8, 0xA4, 0x24, 0xFF}, // 36
-    {0xB8, 0xA0, 0x98, 0xFF}, // 37
-    {0xA4, 0xA4, 0xA4, 0xFF}, // 38
-    {0xDC, 0x84, 0x6C, 0xFF}, // 39
-    {0x64, 0xC4, 0x30, 0xFF}, // 40
-    {0xC0, 0x90, 0x78, 0xFF}, // 41
-    {0x80, 0xB4, 0x5C, 0xFF}, // 42
-    {0xA8, 0x90, 0x88, 0xFF}, // 43
-    {0xC8, 0x8C, 0x28, 0xFF}, // 44
-    {0xA8, 0x8C, 0x9C, 0xFF}, // 45
-    {0xC8, 0x88, 0x2C, 0xFF}, // 46
-    {0xB4, 0x98, 0x34, 0xFF}, // 47
-    {0xB0, 0x90, 0x44, 0xFF}, // 48
-    {0x94, 0x94, 0x94, 0xFF}, // 49
-    {0x94, 0x94, 0x80, 0xFF}, // 50
-    {0x88, 0x84, 0xC4, 0xFF}, // 51
-    {0xB0, 0x84, 0x68, 0xFF}, // 52
-    {0xBC, 0x7C, 0x64, 0xFF}, // 53
-    {0xB8, 0x70, 0x9C, 0xFF}, // 54
-    {0x64, 0xAC, 0x34, 0xFF}, // 55
-    {0xB4, 0x84, 0x24, 0xFF}, // 56
-    {0x84, 0x80, 0xB8, 0xFF}, // 57
-    {0x98, 0x7C, 0x90, 0xFF}, // 58
-    {0x70, 0x9C, 0x40, 0xFF}, // 59
-    {0x94, 0x80, 0x78, 0xFF}, // 60
-    {0xBC, 0x74, 0x2C, 0xFF}, // 61
-    {0x80, 0x80, 0x80, 0xFF}, // 62
-    {0xA0, 0x74, 0x5C, 0xFF}, // 63
-    {0xA8, 0x68, 0x88, 0xFF}, // 64
-    {0x78, 0x78, 0xA8, 0xFF}, // 65
-    {0xA0, 0x74, 0x38, 0xFF}, // 66
-    {0xC0, 0x58, 0x40, 0xFF}, // 67
-    {0x5C, 0x94, 0x34, 0xFF}, // 68
-    {0x88, 0x6C, 0x80, 0xFF}, // 69
-    {0x84, 0x70, 0x68, 0xFF}, // 70
-    {0xA4, 0x68, 0x28, 0xFF}, // 71
-    {0x70, 0x70, 0x9C, 0xFF}, // 72
-    {0x68, 0x78, 0x74, 0xFF}, // 73
-    {0x9C, 0x5C, 0x7C, 0xFF}, // 74
-    {0xA8, 0x60, 0x2C, 0xFF}, // 75
-    {0xA8, 0x60, 0x20, 0xFF}, // 76
-    {0x94, 0x64, 0x50, 0xFF}, // 77
-    {0x70, 0x70, 0x70, 0xFF}, // 78
-    {0x5C, 0x80, 0x38, 0xFF}, // 79
-    {0x8C, 0x5C, 0x6C, 0xFF}, // 80
-    {0x80, 0x60, 0x74, 0xFF}, // 81
-    {0x68, 0x64, 0x90, 0xFF}, // 82
-    {0x9C, 0x60, 0x1C, 0xFF}, // 83
-    {0x40, 0x8C, 0x1C, 0xFF}, // 84
-    {0x84, 0x68, 0x20, 0xFF}, // 85
-    {0x98, 0x58, 0x50, 0xFF}, // 86
-    {0x84, 0x68, 0x20, 0xFF}, // 87
-    {0x60, 0x70, 0x64, 0xFF}, // 88
-    {0x74, 0x60, 0x58, 0xFF}, // 89
-    {0x78, 0x5C, 0x64, 0xFF}, // 90
-    {0x48, 0x7C, 0x24, 0xFF}, // 91
-    {0xD4, 0x2C, 0x24, 0xFF}, // 92
-    {0x90, 0x58, 0x18, 0xFF}, // 93
-    {0x80, 0x58, 0x44, 0xFF}, // 94
-    {0x88, 0x54, 0x34, 0xFF}, // 95
-    {0x54, 0x68, 0x5C, 0xFF}, // 96
-    {0x78, 0x60, 0x1C, 0xFF}, // 97
-    {0x5C, 0x5C, 0x80, 0xFF}, // 98
-    {0x98, 0x48, 0x2C, 0xFF}, // 99
-    {0x5C, 0x5C, 0x80, 0xFF}, // 100
-    {0x34, 0x80, 0x14, 0xFF}, // 101
-    {0x74, 0x60, 0x0C, 0xFF}, // 102
-    {0x5C, 0x5C, 0x5C, 0xFF}, // 103
-    {0x58, 0x54, 0x94, 0xFF}, // 104
-    {0x80, 0x4C, 0x64, 0xFF}, // 105
-    {0x94, 0x44, 0x2C, 0xFF}, // 106
-    {0x70, 0x58, 0x1C, 0xFF}, // 107
-    {0x80, 0x54, 0x10, 0xFF}, // 108
-    {0x70, 0x58, 0x1C, 0xFF}, // 109
-    {0x64, 0x54, 0x50, 0xFF}, // 110
-    {0x54, 0x54, 0x74, 0xFF}, // 111
-    {0x84, 0x48, 0x24, 0xFF}, // 112
-    {0x68, 0x4C, 0x60, 0xFF}, // 113
-    {0xA8, 0x30, 0x24, 0xFF}, // 114
-    {0x74, 0x4C, 0x3C, 0xFF}, // 115
-    {0x50, 0x48, 0x9C, 0xFF}, // 116
-    {0x78, 0x50, 0x10, 0xFF}, // 117
-    {0x6C, 0x4C, 0x58, 0xFF}, // 118
-    {0x5C, 0x54, 0x44, 0xFF}, // 119
-    {0x84, 0x44, 0x2C, 0xFF}, // 120
-    {0x4C, 0x58, 0x54, 0xFF}, // 121
-    {0x70, 0x48, 0x54, 0xFF}, // 122
-    {0x5C, 0x5C, 0x0C, 0xFF}, // 123
-    {0x84, 0x3C, 0x2C, 0xFF}, // 124
-    {0x30, 0x6C, 0x14, 0xFF}, // 125
-    {0x68, 0x54, 0x0C, 0xFF}, // 126
-    {0xAC, 0x28, 0x1C, 0xFF}, // 127
-    {0x68, 0x4C, 0x18, 0xFF}, // 128
-    {0xFC, 0x00, 0x00, 0xFF}, // 129
-    {0x44, 0x54, 0x48, 0xFF}, // 130
-    {0x6C, 0x4C, 0x0C, 0xFF}, // 131
-    {0x4C, 0x48, 0x68, 0xFF}, // 132
-    {0x74, 0x40, 0x2C, 0xFF}, // 133
-    {0x54, 0x54, 0x08, 0xFF}, // 134
-    {0x48, 0x48, 0x68, 0xFF}, // 135
-    {0x68, 0x3C, 0x48, 0xFF}, // 136
-    {0x58, 0x44, 0x50, 0xFF}, // 137
-    {0x50, 0x48, 0x44, 0xFF}, // 138
-    {0x5C, 0x48, 0x18, 0xFF}, // 139
-    {0x44, 0x3C, 0x80, 0xFF}, // 140
-    {0x60, 0x40, 0x28, 0xFF}, // 141
-    {0x74, 0x34, 0x24, 0xFF}, // 142
-    {0x28, 0x60, 0x10, 0xFF}, // 143
-    {0x3C, 0x4C, 0x40, 0xFF}, // 144
-    {0x78, 0x30, 0x14, 0xFF}, // 145
-    {0x4C, 0x4C, 0x08, 0xFF}, // 146
-    {0x5C, 0x40, 0x08, 0xFF}, // 147
-    {0x60, 0x3C, 0x14, 0xFF}, // 148
-    {0x54, 0x40, 0x14, 0xFF}, // 149
-    {0x50, 0x3C, 0x38, 0xFF}, // 150
-    {0x54, 0x40, 0x18, 0xFF}, // 151
-    {0xD0, 0x00, 0x00, 0xFF}, // 152
-    {0x40, 0x3C, 0x58, 0xFF}, // 153
-    {0x58, 0x34, 0x40, 0xFF}, // 154
-    {0x68, 0x30, 0x1C, 0xFF}, // 155
-    {0x3C, 0x34, 0x70, 0xFF}, // 156
-    {0x50, 0x40, 0x10, 0xFF}, // 157
-    {0x34, 0x44, 0x38, 0xFF}, // 158
-    {0x50, 0x3C, 0x04, 0xFF}, // 159
-    {0x40, 0x44, 0x08, 0xFF}, // 160
-    {0x4C, 0x38, 0x18, 0xFF}, // 161
-    {0x50, 0x34, 0x10, 0xFF}, // 162
-    {0x54, 0x2C, 0x34, 0xFF}, // 163
-    {0x4C, 0x34, 0x18, 0xFF}, // 164
-    {0x48, 0x38, 0x14, 0xFF}, // 165
-    {0x48, 0x38, 0x04, 0xFF}, // 166
-    {0x34, 0x30, 0x5C, 0xFF}, // 167
-    {0x48, 0x30, 0x38, 0xFF}, // 168
-    {0xAC, 0x00, 0x00, 0xFF}, // 169
-    {0x30, 0x3C, 0x34, 0xFF}, // 170
-    {0x3C, 0x3C, 0x08, 0xFF}, // 171
-    {0x18, 0x48, 0x08, 0xFF}, // 172
-    {0x44, 0x30, 0x14, 0xFF}, // 173
-    {0x44, 0x30, 0x0C, 0xFF}, // 174
-    {0x4C, 0x28, 0x0C, 0xFF}, // 175
-    {0x44, 0x28, 0x2C, 0xFF}, // 176
-    {0x38, 0x38, 0x04, 0xFF}, // 177
-    {0x40, 0x28, 0x28, 0xFF}, // 178
-    {0x3C, 0x30, 0x14, 0xFF}, // 179
-    {0x28, 0x28, 0x4C, 0xFF}, // 180
-    {0x24, 0x34, 0x2C, 0xFF}, // 181
-    {0x38, 0x2C, 0x20, 0xFF}, // 182
-    {0x38, 0x2C, 0x08, 0xFF}, // 183
-    {0x80, 0x00, 0x00, 0xFF}, // 184
-    {0x30, 0x30, 0x04, 0xFF}, // 185
-    {0x24, 0x24, 0x44, 0xFF}, // 186
-    {0x18, 0x38, 0x04, 0xFF}, // 187
-    {0x34, 0x24, 0x08, 0xFF}, // 188
-    {0x74, 0x00, 0x00, 0xFF}, // 189
-    {0x1C, 0x2C, 0x24, 0xFF}, // 190
-    {0x38, 0x1C, 0x20, 0xFF}, // 191
-    {0x34, 0x20, 0x08, 0xFF}, // 192
-    {0x6C, 0x00, 0x00, 0xFF}, // 193
-    {0x68, 0x00, 0x00, 0xFF}, // 194
-    {0x28, 0x28, 0x04, 0xFF}, // 195
-    {0x60, 0x00, 0x00, 0xFF}, // 196
-    {0x1C, 0x1C, 0x34, 0xFF}, // 197
-    {0x58, 0x00, 0x00, 0xFF}, // 198
-    {0x28, 0x20, 0x04, 0xFF}, // 199
-    {0x2C, 0x18, 0x14, 0xFF}, // 200
-    {0x14, 0x24, 0x18, 0xFF}, // 201
-    {0x0C, 0x28, 0x00, 0xFF}, // 202
-    {0x28, 0x18, 0x18, 0xFF}, // 203
-    {0x50, 0x00, 0x00, 0xFF}, // 204
-    {0x1C, 0x20, 0x00, 0xFF}, // 205
-    {0x48, 0x00, 0x00, 0xFF}, // 206
-    {0x44, 0x00, 0x00, 0xFF}, // 207
-    {0x18, 0x1C, 0x10, 0xFF}, // 208
-    {0x44, 0x00, 0x00, 0xFF}, // 209
-    {0x1C, 0x18, 0x00, 0xFF}, // 210
-    {0x04, 0x20, 0x00, 0xFF}, // 211
-    {0x40, 0x00, 0x00, 0xFF}, // 212
-    {0x14, 0x10, 0x28, 0xFF}, // 213
-    {0x20, 0x10, 0x10, 0xFF}, // 214
-    {0x38, 0x00, 0x00, 0xFF}, // 215
-    {0x38, 0x00, 0x00, 0xFF}, // 216
-    {0x18, 0x14, 0x14, 0xFF}, // 217
-    {0x30, 0x00, 0x00, 0xFF}, // 218
-    {0x08, 0x18, 0x00, 0xFF}, // 219
-    {0x14, 0x14, 0x00, 0xFF}, // 220
-    {0x0C, 0x0C, 0x1C, 0xFF}, // 221
-    {0x28, 0x00, 0x00, 0xFF}, // 222
-    {0x08, 0x10, 0x08, 0xFF}, // 223
-    {0x10, 0x08, 0x08, 0xFF}, // 224
-    {0x0C, 0x0C, 0x00, 0xFF}, // 225
-};
-uint8_t paletteDataRes007[256][4] = {
-    {0x00, 0x00, 0x00, 0xFF}, // 0
-    {0xFC, 0xFC, 0xF4, 0xFF}, // 1
-    {0xFC, 0xF4, 0xF4, 0xFF}, // 2
-    {0xF4, 0xF4, 0xF4, 0xFF}, // 3
-    {0xF4, 0xF4, 0xEC, 0xFF}, // 4
-    {0xF4, 0xEC, 0xEC, 0xFF}, // 5
-    {0xF4, 0xEC, 0xE4, 0xFF}, // 6
-    {0xEC, 0xEC, 0xE4, 0xFF}, // 7
-    {0xEC, 0xEC, 0xDC, 0xFF}, // 8
-    {0xEC, 0xE4, 0xDC, 0xFF}, // 9
-    {0xEC, 0xE4, 0xD4, 0xFF}, // 10
-    {0xE4, 0xE4, 0xD4, 0xFF}, // 11
-    {0xE4, 0xDC, 0xD4, 0xFF}, // 12
-    {0xE4, 0xDC, 0xCC, 0xFF}, // 13
-    {0xE4, 0xD4, 0xCC, 0xFF}, // 14
-    {0xE4, 0xD4, 0xC4, 0xFF}, // 15
-    {0xDC, 0xD4, 0xC4, 0xFF}, // 16
-    {0xDC, 0xD4, 0xBC, 0xFF}, // 17
-    {0xDC, 0xCC, 0xBC, 0xFF}, // 18
-    {0xDC, 0xCC, 0xB4, 0xFF}, // 19
-    {0xD4, 0xCC, 0xBC, 0xFF}, // 20
-    {0xD4, 0xCC, 0xB4, 0xFF}, // 21
-    {0xD4, 0xC4, 0xB4, 0xFF}, // 22
-    {0xD4, 0xC4, 0xAC, 0xFF}, // 23
-    {0xD4, 0xC4, 0xA4, 0xFF}, // 24
-    {0xCC, 0xC4, 0xAC, 0xFF}, // 25
-    {0xCC, 0xBC, 0xA4, 0xFF}, // 26
-    {0xD4, 0xBC, 0x8C, 0xFF}, // 27
-    {0xCC, 0xBC, 0x9C, 0xFF}, // 28
-    {0xC4, 0xBC, 0x9C, 0xFF}, // 29
-    {0xD4, 0xB4, 0x8C, 0xFF}, // 30
-    {0xCC, 0xB4, 0x9C, 0xFF}, // 31
-    {0xD4, 0xB4, 0x84, 0xFF}, // 32
-    {0xCC, 0xB4, 0x94, 0xFF}, // 33
-    {0xD4, 0xB4, 0x78, 0xFF}, // 34
-    {0xCC, 0xB4, 0x8C, 0xFF}, // 35
-    {0xC4, 0xB4, 0x9C, 0xFF}, // 36
-    {0xCC, 0xB4, 0x84, 0xFF}, // 37
-    {0xC4, 0xB4, 0x94, 0xFF}, // 38
-    {0xCC, 0xB4, 0x78, 0xFF}, // 39
-    {0xC4, 0xB4, 0x8C, 0xFF}, // 40
-    {0xC4, 0xB4, 0x84, 0xFF}, // 41
-    {0xC0, 0xB8, 0xA0, 0xFF}, // 42
-    {0xC0, 0xB8, 0x98, 0xFF}, // 43
-    {0xCC, 0xAC, 0x84, 0xFF}, // 44
-    {0xC4, 0xAC, 0x94, 0xFF}, // 45
-    {0xCC, 0xAC, 0x78, 0xFF}, // 46
-    {0xC4, 0xAC, 0x8C, 0xFF}, // 47
-    {0xCC, 0xAC, 0x70, 0xFF}, // 48
-    {0xC4, 0xAC, 0x84, 0xFF}, // 49
-    {0xC0, 0xB0, 0x98, 0xFF}, // 50
-    {0xC4, 0xAC, 0x78, 0xFF}, // 51
-    {0xC0, 0xB0, 0x90, 0xFF}, // 52
-    {0xC4, 0xAC, 0x70, 0xFF}, // 53
-    {0xC0, 0xB0, 0x88, 0xFF}, // 54
-    {0xC0, 0xB0, 0x7C, 0xFF}, // 55
-    {0xB8, 0xB0, 0x90, 0xFF}, // 56
-    {0xC4, 0xA4, 0x78, 0xFF}, // 57
-    {0xC0, 0xA8, 0x90, 0xFF}, // 58
-    {0xC4, 0xA4, 0x70, 0xFF}, // 59
-    {0xC0, 0xA8, 0x88, 0xFF}, // 60
-    {0xC4, 0xA4, 0x68, 0xFF}, // 61
-    {0xC0, 0xA8, 0x7C, 0xFF}, // 62
-    {0xB8, 0xA8, 0x90, 0xFF}, // 63
-    {0xC0, 0xA8, 0x74, 0xFF}, // 64
-    {0xB8, 0xA8, 0x88, 0xFF}, // 65
-    {0xC0, 0xA8, 0x6C, 0xFF}, // 66
-    {0xB8, 0xA8, 0x7C, 0xFF}, // 67
-    {0xB8, 0xA8, 0x74, 0xFF}, // 68
-    {0xB0, 0xA8, 0x88, 0xFF}, // 69
-    {0xC0, 0xA0, 0x74, 0xFF}, // 70
-    {0xC0, 0xA0, 0x6C, 0xFF}, // 71
-    {0xB8, 0xA0, 0x7C, 0xFF}, // 72
-    {0xC0, 0xA0, 0x64, 0xFF}, // 73
-    {0xB0, 0xA0, 0x90, 0xFF}, // 74
-    {0xB8, 0xA0, 0x74, 0xFF}, // 75
-    {0xB0, 0xA0, 0x88, 0xFF}, // 76
-    {0xB8, 0xA0, 0x6C, 0xFF}, // 77
-    {0xB0, 0xA0, 0x7C, 0xFF}, // 78
-    {0xB8, 0xA0, 0x64, 0xFF}, // 79
-    {0xB0, 0xA0, 0x74, 0xFF}, // 80
-    {0xA8, 0xA0, 0x88, 0xFF}, // 81
-    {0xB0, 0xA0, 0x6C, 0xFF}, // 82
-    {0xB8, 0x98, 0x6C, 0xFF}, // 83
-    {0xB8, 0x98, 0x64, 0xFF}, // 84
-    {0xB0, 0x98, 0x74, 0xFF}, // 85
-    {0xB0, 0x98, 0x6C, 0xFF}, // 86
-    {0xA8, 0x98, 0x7C, 0xFF}, // 87
-    {0xB0, 0x98, 0x64, 0xFF}, // 88
-    {0xA8, 0x98, 0x74, 0xFF}, // 89
-    {0xA8, 0x98, 0x6C, 0xFF}, // 90
-    {0xA8, 0x98, 0x64, 0xFF}, // 91
-    {0xA0, 0x98, 0x7C, 0xFF}, // 92
-    {0xB0, 0x90, 0x64, 0xFF}, // 93
-    {0xB0, 0x90, 0x5C, 0xFF}, // 94
-    {0xA8, 0x90, 0x6C, 0xFF}, // 95
-    {0xA8, 0x90, 0x64, 0xFF}, // 96
-    {0xA0, 0x90, 0x74, 0xFF}, // 97
-    {0xA8, 0x90, 0x5C, 0xFF}, // 98
-    {0xA0, 0x90, 0x6C, 0xFF}, // 99
-    {0xA8, 0x90, 0x50, 0xFF}, // 100
-    {0xA0, 0x90, 0x64, 0xFF}, // 101
-    {0xA0, 0x90, 0x5C, 0xFF}, // 102
-    {0xA8, 0x88, 0x5C, 0xFF}, // 103
-    {0xA8, 0x88, 0x50, 0xFF}, // 104
-    {0xA0, 0x88, 0x64, 0xFF}, // 105
-    {0x98, 0x88, 0x74, 0xFF}, // 106
-    {0xA0, 0x88, 0x5C, 0xFF}, // 107
-    {0x98, 0x88, 0x6C, 0xFF}, // 108
-    {0xA0, 0x88, 0x54, 0xFF}, // 109
-    {0x98, 0x88, 0x64, 0xFF}, // 110
-    {0x98, 0x88, 0x5C, 0xFF}, // 111
-    {0x90, 0x88, 0x6C, 0xFF}, // 112
-    {0x98, 0x88, 0x54, 0xFF}, // 113
-    {0x90, 0x88, 0x64, 0xFF}, // 114
-    {0xA0, 0x7C, 0x54, 0xFF}, // 115
-    {0x98, 0x7C, 0x64, 0xFF}, // 116
-    {0x98, 0x7C, 0x5C, 0xFF}, // 117
-    {0x98, 0x7C, 0x54, 0xFF}, // 118
-    {0x90, 0x7C, 0x64, 0xFF}, // 119
-    {0x98, 0x7C, 0x48, 0xFF}, // 120
-    {0x90, 0x7C, 0x5C, 0xFF}, // 121
-    {0x90, 0x7C, 0x54, 0xFF}, // 122
-    {0x90, 0x7C, 0x4C, 0xFF}, // 123
-    {0x88, 0x7C, 0x5C, 0xFF}, // 124
-    {0x98, 0x74, 0x48, 0xFF}, // 125
-    {0x90, 0x74, 0x5C, 0xFF}, // 126
-    {0x90, 0x74, 0x54, 0xFF}, // 127
-    {0x90, 0x74, 0x4C, 0xFF}, // 128
-    {0x88, 0x74, 0x5C, 0xFF}, // 129
-    {0x88, 0x74, 0x54, 0xFF}, // 130
-    {0x7C, 0x74, 0x64, 0xFF}, // 131
-    {0x88, 0x74, 0x4C, 0xFF}, // 132
-    {0x7C, 0x74, 0x54, 0xFF}, // 133
-    {0x88, 0x6C, 0x54, 0xFF}, // 134
-    {0x88, 0x6C, 0x4C, 0xFF}, // 135
-    {0x88, 0x6C, 0x40, 0xFF}, // 136
-    {0x7C, 0x6C, 0x5C, 0xFF}, // 137
-    {0x7C, 0x6C, 0x54, 0xFF}, // 138
-    {0x7C, 0x6C, 0x4C, 0xFF}, // 139
-    {0x7C, 0x6C, 0x44, 0xFF}, // 140
-    {0x74, 0x6C, 0x54, 0xFF}, // 141
-    {0x74, 0x6C, 0x4C, 0xFF}, // 142
-    {0x7C, 0x64, 0x4C, 0xFF}, // 143
-    {0x7C, 0x64, 0x44, 0xFF}, // 144
-    {0x74, 0x64, 0x4C, 0xFF}, // 145
-    {0x74, 0x64, 0x44, 0xFF}, // 146
-    {0x6C, 0x64, 0x54, 0xFF}, // 147
-    {0x74, 0x64, 0x3C, 0xFF}, // 148
-    {0x6C, 0x64, 0x4C, 0xFF}, // 149
-    {0x6C, 0x64, 0x44, 0xFF}, // 150
-    {0x74, 0x5C, 0x44, 0xFF}, // 151
-    {0x74, 0x5C, 0x3C, 0xFF}, // 152
-    {0x6C, 0x5C, 0x4C, 0xFF}, // 153
-    {0x6C, 0x5C, 0x44, 0xFF}, // 154
-    {0x6C, 0x5C, 0x3C, 0xFF}, // 155
-    {0x64, 0x5C, 0x44, 0xFF}, // 156
-    {0x64, 0x5C, 0x3C, 0xFF}, // 157
-    {0x6C, 0x54, 0x3C, 0xFF}, // 158
-    {0x6C, 0x54, 0x30, 0xFF}, // 159
-    {0x64, 0x54, 0x44, 0xFF}, // 160
-    {0x64, 0x54, 0x3C, 0xFF}, // 161
-    {0x5C, 0x54, 0x4C, 0xFF}, // 162
-    {0x64, 0x54, 0x34, 0xFF}, // 163
-    {0x5C, 0x54, 0x44, 0xFF}, // 164
-    {0x5C, 0x54, 0x3C, 0xFF}, // 165
-    {0x5C, 0x54, 0x34, 0xFF}, // 166
-    {0x64, 0x4C, 0x34, 0xFF}, // 167
-    {0x5C, 0x4C, 0x3C, 0xFF}, // 168
-    {0x5C, 0x4C, 0x34, 0xFF}, // 169
-    {0x54, 0x4C, 0x44, 0xFF}, // 170
-    {0x5C, 0x4C, 0x28, 0xFF}, // 171
-    {0x54, 0x4C, 0x3C, 0xFF}, // 172
-    {0x54, 0x4C, 0x34, 0xFF}, // 173
-    {0x54, 0x4C, 0x2C, 0xFF}, // 174
-    {0x4C, 0x4C, 0x3C, 0xFF}, // 175
-    {0x54, 0x44, 0x34, 0xFF}, // 176
-    {0x54, 0x44, 0x2C, 0xFF}, // 177
-    {0x4C, 0x44, 0x3C, 0xFF}, // 178
-    {0x4C, 0x44, 0x34, 0xFF}, // 179
-    {0x4C, 0x44, 0x2C, 0xFF}, // 180
-    {0x44, 0x44, 0x3C, 0xFF}, // 181
-    {0x44, 0x44, 0x2C, 0xFF}, // 182
-    {0x4C, 0x3C, 0x34, 0xFF}, // 183
-    {0x4C, 0x3C, 0x2C, 0xFF}, // 184
-    {0x4C, 0x3C, 0x20, 0xFF}, // 185
-    {0x44, 0x3C, 0x34, 0xFF}, // 186
-    {0x44, 0x3C, 0x2C, 0xFF}, // 187
-    {0x44, 0x3C, 0x24, 0xFF}, // 188
-    {0x40, 0x40, 0x38, 0xFF}, // 189
-    {0x40, 0x40, 0x2C, 0xFF}, // 190
-    {0x40, 0x40, 0x24, 0xFF}, // 191
-    {0x44, 0x34, 0x2C, 0xFF}, // 192
-    {0x44, 0x34, 0x24, 0xFF}, // 193
-    {0x40, 0x38, 0x2C, 0xFF}, // 194
-    {0x40, 0x38, 0x24, 0xFF}, // 195
-    {0x40, 0x38, 0x1C, 0xFF}, // 196
-    {0x38, 0x38, 0x30, 0xFF}, // 197
-    {0x38, 0x38, 0x24, 0xFF}, // 198
-    {0x38, 0x38, 0x1C, 0xFF}, // 199
-    {0x40, 0x2C, 0x24, 0xFF}, // 200
-    {0x40, 0x2C, 0x1C, 0xFF}, // 201
-    {0x38, 0x30, 0x30, 0xFF}, // 202
-    {0x38, 0x30, 0x24, 0xFF}, // 203
-    {0x38, 0x30, 0x1C, 0xFF}, // 204
-    {0x30, 0x30, 0x28, 0xFF}, // 205
-    {0x30, 0x30, 0x1C, 0xFF}, // 206
-    {0x38, 0x24, 0x1C, 0xFF}, // 207
-    {0x30, 0x28, 0x28, 0xFF}, // 208
-    {0x30, 0x28, 0x1C, 0xFF}, // 209
-    {0x30, 0x28, 0x14, 0xFF}, // 210
-    {0x28, 0x28, 0x28, 0xFF}, // 211
-    {0x28, 0x28, 0x20, 0xFF}, // 212
-    {0x28, 0x28, 0x14, 0xFF}, // 213
-    {0x28, 0x20, 0x20, 0xFF}, // 214
-    {0x28, 0x20, 0x14, 0xFF}, // 215
-    {0x20, 0x20, 0x20, 0xFF}, // 216
-    {0x20, 0x20, 0x14, 0xFF}, // 217
-    {0x20, 0x20, 0x0C, 0xFF}, // 218
-    {0x20, 0x14, 0x14, 0xFF}, // 219
-    {0x20, 0x14, 0x0C, 0xFF}, // 220
-    { 0x18, 0x18, 0x18, 0xFF }, // 221
-    { 0x18, 0x18, 0x0C, 0xFF }, // 222
-    { 0x18, 0x00, 0x0C, 0xFF }, // 223
-    { 0xFC, 0xFC, 0xFC, 0xFF }, // 224
-    { 0x10, 0x10, 0x10, 0xFF }, // 225
-    { 0x10, 0x10, 0x00, 0xFF }, // 226
-    { 0x10, 0x00, 0x00, 0xFF }, // 227
-    { 0x00, 0x00, 0x00, 0xFF }, // 228
-    { 0x00, 0x00, 0x00, 0xFF }, // 229
-    { 0x00, 0x00, 0x00, 0xFF }, // 230
-    { 0x00, 0x00, 0x00, 0xFF }, // 231
-    { 0x00, 0x00, 0x00, 0xFF }, // 232
-    { 0x00, 0x00, 0x00, 0xFF }, // 233
-    { 0x00, 0x00, 0x00, 0xFF }, // 234
-    { 0x00, 0x00, 0x00, 0xFF }, // 235
-    { 0x00, 0x00, 0x00, 0xFF }, // 236
-    { 0x00, 0x00, 0x00, 0xFF }, // 237
-    { 0x00, 0x00, 0x00, 0xFF }, // 238
-    { 0x00, 0x00, 0x00, 0xFF }, // 239
-    { 0x00, 0x00, 0x00, 0xFF }, // 240
-    { 0x00, 0x00, 0x00, 0xFF }, // 241
-    { 0x00, 0x00, 0x00, 0xFF }, // 242
-    { 0x00, 0x00, 0x00, 0xFF }, // 243
-    { 0x00, 0x00, 0x00, 0xFF }, // 244
-    { 0x00, 0x00, 0x00, 0xFF }, // 245
-    { 0x00, 0x00, 0x00, 0xFF }, // 246
-    { 0x00, 0x00, 0x00, 0xFF }, // 247
-    { 0x00, 0x00, 0x00, 0xFF }, // 248
-    { 0x00, 0x00, 0x00, 0xFF }, // 249
-    { 0x00, 0x00, 0x00, 0xFF }, // 250
-    { 0x00, 0x00, 0x00, 0xFF }, // 251
-    { 0x00, 0x00, 0x00, 0xFF }, // 252
-    { 0x00, 0x00, 0x00, 0xFF }, // 253
-    { 0x00, 0x00, 0x00, 0xFF }, // 254
-    { 0x00, 0x00, 0xFC, 0xFF }, // 255
-};
-
-std::vector<uint8_t> generateSanitariumPalette(uint8_t paletteData[256][4]) {
-    std::vector<uint8_t> palette(256 * 3);
-
-    // Copy the palette data into the output vector
-    for (int i = 0; i < 256; i++) {
-        palette[i * 3] = paletteData[i][0];     // R
-        palette[i * 3 + 1] = paletteData[i][1]; // G
-        palette[i * 3 + 2] = paletteData[i][2]; // B
-    }
-
-    return palette;
+// Bytes in one BMP row, rows are padded to a multiple of 4
+uint32_t bmpRowSize(uint32_t width, BitmapMode mode) {
+    uint32_t bytesPerPixel = mode == BitmapMode::Indexed ? 1 : 3;
+    return (width * bytesPerPixel + 3) & ~3u;
 }
 
-// Extracts a single frame from the resource to a BMP file
-bool extractFrameToBMP(const char* resourceData, uint32_t frameIndex, const std::string& outputFilename, const std::vector<uint8_t>& palette) {
-    uint16_t frameCount = static_cast<uint16_t>(
-        static_cast<uint8_t>(resourceData[0x18]) |
-        (static_cast<uint8_t>(resourceData[0x19]) << 8)
-        );
-
-    if (frameIndex >= frameCount)
-        return false;
-
-    uint32_t offsetPos = 0x1C + (frameIndex * 4);
-    uint32_t frameOffset = static_cast<uint8_t>(resourceData[offsetPos]) |
-        (static_cast<uint8_t>(resourceData[offsetPos + 1]) << 8) |
-        (static_cast<uint8_t>(resourceData[offsetPos + 2]) << 16) |
-        (static_cast<uint8_t>(resourceData[offsetPos + 3]) << 24);
-
-    uint32_t offsetsArrayEnd = 0x1C + (frameCount * 4);
-    uint32_t framePosition = offsetsArrayEnd + frameOffset;
-
-    uint16_t height = static_cast<uint16_t>(
-        static_cast<uint8_t>(resourceData[framePosition + 0x0C]) |
-        (static_cast<uint8_t>(resourceData[framePosition + 0x0C + 1]) << 8)
-        );
-
-    uint16_t width = static_cast<uint16_t>(
-        static_cast<uint8_t>(resourceData[framePosition + 0x0E]) |
-        (static_cast<uint8_t>(resourceData[framePosition + 0x0E + 1]) << 8)
-        );
-
-    // Raw pixel data starts at offset 0x10 from frame header
-    const uint8_t* indexedData = reinterpret_cast<const uint8_t*>(resourceData + framePosition + 0x10);
-
-    // Here we calculate the size of the BMP
-    // Each pixel in BMP uses 3 bytes (RGB), values go from 0 to 255. We need to add the
-    // extra 3 bytes to make sure we're rounding up correctly
-    int paddedWidth = (width * 3 + 3) & ~3;
-    int imageDataSize = paddedWidth * height;
+// Appends the BMP and DIB headers, followed by the color table for indexed bitmaps
+void appendBMPHeaders(std::vector<uint8_t>& bmp, uint32_t width, uint32_t height, BitmapMode mode, const PaletteLUT& paletteLUT) {
+    uint32_t colorTableSize = mode == BitmapMode::Indexed ? 256 * 4 : 0;
+    uint32_t imageDataSize = bmpRowSize(width, mode) * height;
 
     BMPHeader bmpHeader;
     DIBHeader dibHeader;
 
     // -- BMP HEADER --
     bmpHeader.signature = 0x4D42; // 'BM'
-    bmpHeader.fileSize = sizeof(BMPHeader) + sizeof(DIBHeader) + imageDataSize;
+    bmpHeader.fileSize = sizeof(BMPHeader) + sizeof(DIBHeader) + colorTableSize + imageDataSize;
     bmpHeader.reserved1 = 0;
     bmpHeader.reserved2 = 0;
-    bmpHeader.dataOffset = sizeof(BMPHeader) + sizeof(DIBHeader);
+    bmpHeader.dataOffset = sizeof(BMPHeader) + sizeof(DIBHeader) + colorTableSize;
 
     // -- DIB HEADER --
     dibHeader.headerSize = sizeof(DIBHeader);
     dibHeader.width = width;
     dibHeader.height = height;
     dibHeader.planes = 1;
-    dibHeader.bitsPerPixel = 24; // RGB
+    dibHeader.bitsPerPixel = mode == BitmapMode::Indexed ? 8 : 24;
     dibHeader.compression = 0; // No compression
     dibHeader.imageSize = 0; // We can actually leave this at 0 if compression = 0
     dibHeader.xPixelsPerM = 0; // Same as previous point
@@ -704,200 +210,275 @@ bool extractFrameToBMP(const char* resourceData, uint32_t frameIndex, const std:
     dibHeader.colorsUsed = 256;
     dibHeader.importantColors = 0;
 
-    // Output
-    std::ofstream file(outputFilename, std::ios::binary);
-    if (!file.is_open()) {
-        return false;
-    }
-
-    // Creating headers
-    file.write(reinterpret_cast<const char*>(&bmpHeader), sizeof(BMPHeader));
-    file.write(reinterpret_cast<const char*>(&dibHeader), sizeof(DIBHeader));
+    const uint8_t* bmpHeaderBytes = reinterpret_cast<const uint8_t*>(&bmpHeader);
+    const uint8_t* dibHeaderBytes = reinterpret_cast<const uint8_t*>(&dibHeader);
+    bmp.insert(bmp.end(), bmpHeaderBytes, bmpHeaderBytes + sizeof(BMPHeader));
+    bmp.insert(bmp.end(), dibHeaderBytes, dibHeaderBytes + sizeof(DIBHeader));
 
-    // Allocate buffer for one row of RGB data with padding
-    std::vector<uint8_t> rowBuffer(paddedWidth, 0);
+    if (mode == BitmapMode::Indexed) {
+        // The lookup table is already B, G, R, A per entry, BMP wants the last byte to be 0
+        uint32_t colorTable[256];
+        for (int i = 0; i < 256; ++i) {
+            colorTable[i] = paletteLUT.bgra[i] & 0x00FFFFFF;
+        }
+        const uint8_t* colorTableBytes = reinterpret_cast<const uint8_t*>(colorTable);
+        bmp.insert(bmp.end(), colorTableBytes, colorTableBytes + sizeof(colorTable));
+    }
+}
 
-    // Write pixel data (bottom-up)
-    for (int y = height - 1; y >= 0; --y) {
-        for (int x = 0; x < width; ++x) {
-            uint8_t index = indexedData[y * width + x];
+// Encodes the region of a width pixels wide frame as a complete BMP file
+std::vector<uint8_t> encodeFrameBMP(const uint8_t* indexedData, uint32_t width, const FrameBounds& region, const PaletteLUT& paletteLUT, BitmapMode mode) {
+    // Here we calculate the size of a BMP row
+    // Each pixel uses 3 bytes (BGR) or 1 byte (palette index), rows are padded to 4 bytes
+    uint32_t paddedWidth = bmpRowSize(region.width, mode);
 
-            // Convert indexed color to RGB using palette
-            // Each index points to a set of 3 values in the palette (R,G,B)
-            rowBuffer[x * 3] = palette[index * 3 + 2];     // B
-            rowBuffer[x * 3 + 1] = palette[index * 3 + 1];     // G
-            rowBuffer[x * 3 + 2] = palette[index * 3];     // R
+    // Creating headers
+    std::vector<uint8_t> bmp;
+    appendBMPHeaders(bmp, region.width, region.height, mode, paletteLUT);
+
+    // Pixel data follows, padding bytes stay 0
+    size_t pixelStart = bmp.size();
+    bmp.resize(pixelStart + static_cast<size_t>(paddedWidth) * region.height, 0);
+
+    // Rows are stored bottom-up
+    for (uint32_t y = 0; y < region.height; ++y) {
+        const uint8_t* source = indexedData + static_cast<size_t>(region.y + y) * width + region.x;
+        uint8_t* row = bmp.data() + pixelStart + static_cast<size_t>(region.height - 1 - y) * paddedWidth;
+        if (mode == BitmapMode::Indexed) {
+            // Indices are already what the color table refers to
+            std::memcpy(row, source, region.width);
+        }
+        else {
+            // Convert the whole row of indices to BGR through the palette table
+            convertIndicesToBGR(source, region.width, paletteLUT, row);
         }
-
-        // Write the row
-        file.write(reinterpret_cast<const char*>(rowBuffer.data()), paddedWidth);
     }
 
-    file.close();
-    return true;
+    return bmp;
 }
 
-// Extracts the frames to a single spritesheet instead of separate frames
-bool extractFramesToSpritesheet(const char* resourceData, const std::string& outputFilename, const std::vector<uint8_t>& palette) {
-    uint16_t frameCount = static_cast<uint16_t>(
-        static_cast<uint8_t>(resourceData[0x18]) |
-        (static_cast<uint8_t>(resourceData[0x19]) << 8)
-        );
+// Writes the region of a width pixels wide frame to a BMP file, through writer when there is one
+bool writeFrameBMP(const uint8_t* indexedData, uint32_t width, const FrameBounds& region, const std::string& outputFilename, const PaletteLUT& paletteLUT,
+    BitmapMode mode, OutputWriter* writer = nullptr) {
+    std::vector<uint8_t> bmp = encodeFrameBMP(indexedData, width, region, paletteLUT, mode);
+    if (writer) {
+        writer->submit(outputFilename, std::move(bmp));
+        return true;
+    }
+    return writeOutputFile(outputFilename, bmp.data(), bmp.size());
+}
 
-    if (frameCount == 0)
-        return false;
+// Part of a frame that gets written, everything but the transparent (index 0) border with trim
+FrameBounds frameRegion(const uint8_t* indexedData, uint16_t width, uint16_t height, bool trim) {
+    if (trim)
+        return findOpaqueBounds(indexedData, width, height);
 
-    std::vector<uint16_t> frameWidths(frameCount);
-    std::vector<uint16_t> frameHeights(frameCount);
-    std::vector<uint32_t> framePositions(frameCount);
+    FrameBounds region;
+    region.width = width;
+    region.height = height;
+    return region;
+}
 
-    uint32_t offsetsArrayEnd = 0x1C + (frameCount * 4);
-    uint32_t totalWidth = 0;
-    uint16_t maxHeight = 0;
+// Extracts a single frame from the resource to a BMP file
+// With trim the transparent border is left out, writtenRegion tells which part of the frame was written
+bool extractFrameToBMP(const D3GRView& resource, uint32_t frameIndex, const std::string& outputFilename, const PaletteLUT& paletteLUT,
+    BitmapMode mode = BitmapMode::TrueColor, bool trim = false, FrameBounds* writtenRegion = nullptr) {
+    if (frameIndex >= resource.frameCount())
+        return false;
 
-    for (uint16_t i = 0; i < frameCount; ++i) {
-        uint32_t offsetPos = 0x1C + (i * 4);
-        uint32_t frameOffset = static_cast<uint8_t>(resourceData[offsetPos]) |
-            (static_cast<uint8_t>(resourceData[offsetPos + 1]) << 8) |
-            (static_cast<uint8_t>(resourceData[offsetPos + 2]) << 16) |
-            (static_cast<uint8_t>(resourceData[offsetPos + 3]) << 24);
+    const FrameView& frame = resource.frame(frameIndex);
+    FrameBounds region = frameRegion(frame.indices(), frame.width(), frame.height(), trim);
+    if (writtenRegion) {
+        *writtenRegion = region;
+    }
 
-        uint32_t framePosition = offsetsArrayEnd + frameOffset;
-        framePositions[i] = framePosition;
+    return writeFrameBMP(frame.indices(), frame.width(), region, outputFilename, paletteLUT, mode);
+}
 
-        uint16_t height = static_cast<uint16_t>(
-            static_cast<uint8_t>(resourceData[framePosition + 0x0C]) |
-            (static_cast<uint8_t>(resourceData[framePosition + 0x0C + 1]) << 8)
-            );
+// Identifies the file a frame turns into: its pixels, size, the written region and the palette and mode they're written with
+uint64_t frameContentKey(const uint8_t* indexedData, uint16_t width, uint16_t height, const FrameBounds& region, uint64_t paletteHash, BitmapMode mode) {
+    const uint32_t layout[7] = { width, height, region.x, region.y, region.width, region.height, static_cast<uint32_t>(mode) };
+    uint64_t layoutHash = hashBytes(layout, sizeof(layout), paletteHash);
+    return hashBytes(indexedData, static_cast<size_t>(width) * height, layoutHash);
+}
 
-        uint16_t width = static_cast<uint16_t>(
-            static_cast<uint8_t>(resourceData[framePosition + 0x0E]) |
-            (static_cast<uint8_t>(resourceData[framePosition + 0x0E + 1]) << 8)
-            );
+// Image being composed in memory, already in BMP order: one contiguous buffer, rows bottom-up and padded
+struct BitmapCanvas {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t rowSize = 0;
+    BitmapMode mode = BitmapMode::TrueColor;
+    std::vector<uint8_t> pixels;
 
-        frameWidths[i] = width;
-        frameHeights[i] = height;
+    uint8_t* row(uint32_t y) { return pixels.data() + static_cast<size_t>(height - 1 - y) * rowSize; }
+};
 
-        totalWidth += width;
-        maxHeight = std::max(maxHeight, height);
+// Canvas filled with the background, padding bytes stay 0
+BitmapCanvas createCanvas(uint32_t width, uint32_t height, BitmapMode mode, uint8_t background) {
+    BitmapCanvas canvas;
+    canvas.width = width;
+    canvas.height = height;
+    canvas.rowSize = bmpRowSize(width, mode);
+    canvas.mode = mode;
+    canvas.pixels.assign(static_cast<size_t>(canvas.rowSize) * height, 0);
+
+    size_t usedBytes = static_cast<size_t>(width) * (mode == BitmapMode::Indexed ? 1 : 3);
+    for (uint32_t y = 0; y < height; ++y) {
+        std::memset(canvas.row(y), background, usedBytes);
     }
+    return canvas;
+}
 
-    uint32_t targetWidth = static_cast<uint32_t>(std::sqrt(totalWidth * maxHeight));
-
-    uint32_t currentX = 0;
-    uint32_t currentY = 0;
-    uint32_t rowHeight = 0;
-    uint32_t spritesheetWidth = 0;
-    uint32_t spritesheetHeight = 0;
+// Copies width x height indices (rows stride bytes apart) onto the canvas with their top left corner at x, y, clipped to the canvas
+void blitFrame(BitmapCanvas& canvas, const uint8_t* indexedData, uint32_t stride, uint32_t width, uint32_t height, uint32_t x, uint32_t y, const PaletteLUT& paletteLUT) {
+    if (x >= canvas.width || y >= canvas.height)
+        return;
 
-    std::vector<std::pair<uint32_t, uint32_t>> framePositionsInSheet(frameCount);
+    // Clip once, then every row is a bulk copy
+    uint32_t copyWidth = std::min(width, canvas.width - x);
+    uint32_t copyHeight = std::min(height, canvas.height - y);
 
-    // Positions for each frame in the spritesheet
-    for (uint16_t i = 0; i < frameCount; ++i) {
-        // If this frame won't fit on current row, move to next row
-        if (currentX + frameWidths[i] > targetWidth && currentX > 0) {
-            currentX = 0;
-            currentY += rowHeight;
-            rowHeight = 0;
+    for (uint32_t row = 0; row < copyHeight; ++row) {
+        const uint8_t* source = indexedData + static_cast<size_t>(row) * stride;
+        if (canvas.mode == BitmapMode::Indexed) {
+            std::memcpy(canvas.row(y + row) + x, source, copyWidth);
+        }
+        else {
+            convertIndicesToBGR(source, copyWidth, paletteLUT, canvas.row(y + row) + x * 3);
         }
+    }
+}
 
-        framePositionsInSheet[i] = { currentX, currentY };
+bool writeCanvasToBMP(const BitmapCanvas& canvas, const std::string& outputFilename, const PaletteLUT& paletteLUT, OutputWriter* writer = nullptr) {
+    std::vector<uint8_t> bmp;
+    bmp.reserve(sizeof(BMPHeader) + sizeof(DIBHeader) + 256 * 4 + canvas.pixels.size());
+    appendBMPHeaders(bmp, canvas.width, canvas.height, canvas.mode, paletteLUT);
+    bmp.insert(bmp.end(), canvas.pixels.begin(), canvas.pixels.end());
 
-        // Update position for next frame
-        currentX += frameWidths[i];
-        rowHeight = std::max(rowHeight, static_cast<uint32_t>(frameHeights[i]));
+    if (writer) {
+        writer->submit(outputFilename, std::move(bmp));
+        return true;
+    }
+    return writeOutputFile(outputFilename, bmp.data(), bmp.size());
+}
 
-        // Update spritesheet dimensions
-        spritesheetWidth = std::max(spritesheetWidth, currentX);
-        spritesheetHeight = std::max(spritesheetHeight, currentY + rowHeight);
+// Writes a metadata file, through writer when there is one
+bool writeTextOutput(const std::string& outputFilename, const std::string& text, OutputWriter* writer) {
+    if (writer) {
+        writer->submit(outputFilename, std::vector<uint8_t>(text.begin(), text.end()));
+        return true;
     }
+    return writeOutputFile(outputFilename, text.data(), text.size());
+}
 
-    if (spritesheetWidth > 8192 || spritesheetHeight > 8192) {
-        std::cerr << "Spritesheet dimensions too large: " << spritesheetWidth << "x" << spritesheetHeight << std::endl;
-        return false;
+// Writes the atlas metadata: where every frame is on which page
+// trims holds the part of each frame that was packed, x and y being its offset in the original frame
+bool writeAtlasMetadata(const std::string& outputFilename, const std::vector<AtlasRect>& rects, const std::vector<FrameBounds>& trims,
+    const std::vector<AtlasRect>& sourceSizes, const std::vector<AtlasPage>& pages, const std::vector<std::string>& pageFiles, OutputWriter* writer = nullptr) {
+    std::ostringstream file;
+    file << "{\n  \"pages\": [\n";
+    for (size_t i = 0; i < pages.size(); ++i) {
+        file << "    {\"file\": \"" << pageFiles[i] << "\", \"width\": " << pages[i].width
+            << ", \"height\": " << pages[i].height << "}" << (i + 1 < pages.size() ? "," : "") << "\n";
+    }
+    file << "  ],\n  \"frames\": [\n";
+    for (size_t i = 0; i < rects.size(); ++i) {
+        file << "    {\"frame\": " << i << ", \"page\": " << rects[i].page
+            << ", \"x\": " << rects[i].x << ", \"y\": " << rects[i].y
+            << ", \"width\": " << rects[i].width << ", \"height\": " << rects[i].height
+            << ", \"trimX\": " << trims[i].x << ", \"trimY\": " << trims[i].y
+            << ", \"sourceWidth\": " << sourceSizes[i].width << ", \"sourceHeight\": " << sourceSizes[i].height << "}"
+            << (i + 1 < rects.size() ? "," : "") << "\n";
     }
+    file << "  ]\n}\n";
+    return writeTextOutput(outputFilename, file.str(), writer);
+}
 
-    int paddedWidth = (spritesheetWidth * 3 + 3) & ~3;
-    int imageDataSize = paddedWidth * spritesheetHeight;
+// Packs the frames into spritesheet pages instead of separate frames
+// Writes <outputBase>.bmp, or <outputBase>_<page>.bmp when more than one page is needed, and <outputBase>.json
+// With trim only the part of each frame inside its transparent (index 0) border is packed
+bool extractFramesToSpritesheet(const D3GRView& resource, const std::string& outputBase, const PaletteLUT& paletteLUT,
+    BitmapMode mode = BitmapMode::TrueColor, uint32_t maxPageSize = 8192, bool trim = false, std::ostream& log = std::cout, OutputWriter* writer = nullptr,
+    std::vector<std::string>* outputFiles = nullptr) {
+    const std::vector<FrameView>& frames = resource.frames();
+    uint16_t frameCount = static_cast<uint16_t>(frames.size());
 
-    BMPHeader bmpHeader;
-    DIBHeader dibHeader;
+    if (frameCount == 0)
+        return false;
 
-    // -- BMP HEADER --
-    bmpHeader.signature = 0x4D42; // 'BM'
-    bmpHeader.fileSize = sizeof(BMPHeader) + sizeof(DIBHeader) + imageDataSize;
-    bmpHeader.reserved1 = 0;
-    bmpHeader.reserved2 = 0;
-    bmpHeader.dataOffset = sizeof(BMPHeader) + sizeof(DIBHeader);
+    std::vector<AtlasRect> rects(frameCount);
+    for (uint16_t i = 0; i < frameCount; ++i) {
+        rects[i].width = frames[i].width();
+        rects[i].height = frames[i].height();
+    }
 
-    // -- DIB HEADER --
-    dibHeader.headerSize = sizeof(DIBHeader);
-    dibHeader.width = spritesheetWidth;
-    dibHeader.height = spritesheetHeight;
-    dibHeader.planes = 1;
-    dibHeader.bitsPerPixel = 24; // RGB
-    dibHeader.compression = 0; // No compression
-    dibHeader.imageSize = 0; // Can leave as 0 if no compression
-    dibHeader.xPixelsPerM = 0;
-    dibHeader.yPixelsPerM = 0;
-    dibHeader.colorsUsed = 256;
-    dibHeader.importantColors = 0;
+    // Frame sizes as stored, the packer gets the trimmed sizes
+    std::vector<AtlasRect> sourceSizes = rects;
+    std::vector<FrameBounds> trims(frameCount);
+    for (uint16_t i = 0; i < frameCount; ++i) {
+        trims[i].width = rects[i].width;
+        trims[i].height = rects[i].height;
+        if (trim) {
+            trims[i] = findOpaqueBounds(frames[i].indices(), rects[i].width, rects[i].height);
+        }
+        rects[i].width = trims[i].width;
+        rects[i].height = trims[i].height;
+    }
 
-    std::ofstream file(outputFilename, std::ios::binary);
-    if (!file.is_open()) {
+    std::vector<AtlasPage> pages;
+    if (!packAtlas(rects, maxPageSize, pages)) {
+        std::cerr << "A frame is larger than the maximum spritesheet page size of " << maxPageSize << std::endl;
         return false;
     }
 
-    file.write(reinterpret_cast<const char*>(&bmpHeader), sizeof(BMPHeader));
-    file.write(reinterpret_cast<const char*>(&dibHeader), sizeof(DIBHeader));
+    // White background by default, indexed sheets use the palette entry closest to white
+    uint8_t background = mode == BitmapMode::Indexed ? findNearestPaletteIndex(paletteLUT, 255, 255, 255) : 255;
 
-    // White pixel data by default
-    std::vector<std::vector<uint8_t>> pixelData(spritesheetHeight, std::vector<uint8_t>(spritesheetWidth * 3, 255));
+    std::vector<std::string> pageFiles;
+    for (uint32_t page = 0; page < pages.size(); ++page) {
+        std::string pagePath = pages.size() == 1 ? outputBase + ".bmp" : outputBase + "_" + std::to_string(page) + ".bmp";
+        pageFiles.push_back(std::filesystem::path(pagePath).filename().string());
 
-    for (uint16_t i = 0; i < frameCount; ++i) {
-        uint32_t frameX = framePositionsInSheet[i].first;
-        uint32_t frameY = framePositionsInSheet[i].second;
-        uint16_t width = frameWidths[i];
-        uint16_t height = frameHeights[i];
-
-        // Raw pixel data starts at offset 0x10 from frame header
-        const uint8_t* indexedData = reinterpret_cast<const uint8_t*>(resourceData + framePositions[i] + 0x10);
-
-        // Copy frame data to spritesheet
-        for (uint16_t y = 0; y < height; ++y) {
-            for (uint16_t x = 0; x < width; ++x) {
-                uint8_t index = indexedData[y * width + x];
-
-                // Ensure we don't write outside the buffer
-                if (frameY + y < spritesheetHeight && frameX + x < spritesheetWidth) {
-                    // In BMP, pixels are ordered as BGR
-                    pixelData[frameY + y][(frameX + x) * 3 + 0] = palette[index * 3 + 2]; // B
-                    pixelData[frameY + y][(frameX + x) * 3 + 1] = palette[index * 3 + 1]; // G
-                    pixelData[frameY + y][(frameX + x) * 3 + 2] = palette[index * 3 + 0]; // R
-                }
-            }
-        }
-    }
+        BitmapCanvas canvas = createCanvas(pages[page].width, pages[page].height, mode, background);
+
+        for (uint16_t i = 0; i < frameCount; ++i) {
+            if (rects[i].page != page)
+                continue;
 
-    std::vector<uint8_t> rowBuffer(paddedWidth, 0);
+            const uint8_t* region = frames[i].indices() + static_cast<size_t>(trims[i].y) * sourceSizes[i].width + trims[i].x;
+            blitFrame(canvas, region, sourceSizes[i].width, rects[i].width, rects[i].height, rects[i].x, rects[i].y, paletteLUT);
+        }
 
-    // Write pixel data (bottom-up)
-    for (int y = spritesheetHeight - 1; y >= 0; --y) {
-        // Copy row data to padded buffer
-        std::memcpy(rowBuffer.data(), pixelData[y].data(), pixelData[y].size());
+        if (!writeCanvasToBMP(canvas, pagePath, paletteLUT, writer)) {
+            return false;
+        }
+        if (outputFiles) {
+            outputFiles->push_back(pagePath);
+        }
 
-        // Write the row
-        file.write(reinterpret_cast<const char*>(rowBuffer.data()), paddedWidth);
+        log << "Created spritesheet page " << pagePath << ", dimensions: "
+            << pages[page].width << "x" << pages[page].height << std::endl;
     }
 
-    file.close();
+    if (!writeAtlasMetadata(outputBase + ".json", rects, trims, sourceSizes, pages, pageFiles, writer)) {
+        return false;
+    }
+    if (outputFiles) {
+        outputFiles->push_back(outputBase + ".json");
+    }
 
-    std::cout << "Created spritesheet with " << frameCount << " frames, dimensions: "
-        << spritesheetWidth << "x" << spritesheetHeight << std::endl;
+    log << "Created spritesheet with " << frameCount << " frames on " << pages.size() << " page(s)" << std::endl;
 
     return true;
 }
 
+// Packs only hold files, the directories are implied by their paths
+void createOutputDirectory(const std::string& path, const ExtractionOptions& options) {
+    if (options.writer && options.writer->backend() == OutputWriter::Backend::Pack)
+        return;
+    std::filesystem::create_directory(path);
+}
+
 // Just to make sure Windows doesn't get mad at me (:
 std::string cleanFolderName(const std::string& input) {
     std::string result = input;
@@ -921,258 +502,2266 @@ std::string cleanFolderName(const std::string& input) {
     return result;
 }
 
-// -- MAIN EXTRACTION FUNCTION --
-bool extractFiles(const std::string& filename, FileFormat format, bool extractIndividualFrames = true, bool extractSpritesheet = false, const std::vector<uint8_t>& palette = std::vector<uint8_t>()) {
-    const FormatInfo& info = formatInfoMap.at(format);
-
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Failed to open file: " << filename << std::endl;
-        return false;
+// Records the position and size of every frame of a D3GR resource
+void indexGraphicsResourceFrames(std::span<const std::byte> resource, std::vector<IndexedFrame>& frames) {
+    const D3GRView view(resource);
+    for (const FrameView& frame : view.frames()) {
+        frames.push_back({ frame.offset(), frame.width(), frame.height() });
     }
+}
 
-    // Read file into buffer
-    std::vector<char> fileBuffer((std::istreambuf_iterator<char>(file)),
-        std::istreambuf_iterator<char>());
+// A resource on its way through extraction. Graphics resources are split into parts (every frame and the
+// spritesheet) that can run on different threads, whoever finishes the last part writes the rest of the
+// resource's log and metadata.
+struct ResourceJob {
+    size_t formatIndex = 0;
+    int resourceIndex = 0;
+    const char* data = nullptr;
+    uint32_t size = 0;
+    size_t offset = 0;
+    std::ostringstream log;
+    int frameCount = 0;                     // Frames extracted, set once the resource is finished
+    uint64_t hash = 0;                      // Content hash for the output manifest
+    bool skipped = false;                   // Outputs of the last run were current
+
+    // Graphics resources
+    std::string framesFolder;
+    std::string spritesheetPath;
+    D3GRView view;                          // Frame table, read once
+    std::vector<FrameBounds> regions;       // Part of each frame that gets written
+    std::vector<uint64_t> frameKeys;        // Frame store key of each frame
+    bool framesBegun = false;               // Frame table read, the pipeline finishes the resource after its stages
+    std::atomic<size_t> pendingParts{ 0 };
+    std::atomic<int> extractedFrames{ 0 };
+    bool spritesheetCreated = false;
+    std::ostringstream spritesheetLog;
+    std::vector<std::string> spritesheetFiles;  // Pages and metadata written
+};
 
-    file.close();
+const uint8_t* graphicsFrameData(const ResourceJob& job, uint16_t i) {
+    return job.view.frame(i).indices();
+}
 
-    if (fileBuffer.empty()) {
-        std::cerr << "File is empty" << std::endl;
-        return false;
-    }
+std::string graphicsFramePath(const ResourceJob& job, uint16_t i) {
+    return job.framesFolder + "/frame_" + std::to_string(i) + ".bmp";
+}
 
-    std::cout << "File size: " << fileBuffer.size() << " bytes" << std::endl;
-    std::cout << "Searching for " << info.name << " files..." << std::endl;
+// Reads the frame table and creates the frames folder, returns the parts to run: every frame and the spritesheet, as requested
+size_t beginGraphicsResource(ResourceJob& job, const std::string& subfolder, const ExtractionOptions& options) {
+    job.framesFolder = subfolder + "/frames_" + std::to_string(job.resourceIndex);
+    createOutputDirectory(job.framesFolder, options);
+    job.spritesheetPath = subfolder + "/spritesheet_" + std::to_string(job.resourceIndex);
 
-    size_t position = 0;
-    int fileCount = 0;
-    int frameCount = 0; // For counting total frames (for D3GR)
+    job.view = D3GRView(asBytes(job.data, job.size));
+    job.regions.assign(job.view.frameCount(), FrameBounds());
+    job.frameKeys.assign(job.view.frameCount(), 0);
 
+    job.log << "  Resource contains " << job.view.frameCount() << " frames" << std::endl;
 
-    std::string cleanFilename = cleanFolderName(filename);
-    std::filesystem::create_directory(info.folderName);
-    std::string subfolder = info.folderName + "/" + cleanFilename;
-    std::filesystem::create_directory(subfolder);
+    size_t parts = (options.extractIndividualFrames ? job.view.frameCount() : 0) + (options.extractSpritesheet ? 1 : 0);
+    job.pendingParts = parts;
+    return parts;
+}
 
-    // Function pointers for header detection and size calculation
-    size_t(*findHeader)(const char*, size_t) = nullptr;
-    uint32_t(*getSize)(const char*) = nullptr;
+uint64_t graphicsFrameRank(const ResourceJob& job, uint16_t i, const ExtractionOptions& options) {
+    return FrameStore::rank(options.archiveRank, static_cast<uint32_t>(job.resourceIndex), i);
+}
 
-    switch (format) {
-    case FileFormat::WAV:
-        findHeader = findWavHeader;
-        getSize = getWavSize;
-        break;
-    case FileFormat::D3GR:
-        findHeader = findGraphicsResourceHeader;
-        getSize = getGraphicsResourceSize;
-        break;
+// Finds the part of frame i that gets written and claims its content, frames identical to one claimed before are linked to it
+// Returns true when the frame still has to be encoded, key is then its frame store key
+bool decodeGraphicsFrame(ResourceJob& job, uint16_t i, uint64_t paletteHash, const ExtractionOptions& options, uint64_t& key) {
+    const FrameView& frame = job.view.frame(i);
+    const uint8_t* indexedData = frame.indices();
+    job.regions[i] = frameRegion(indexedData, frame.width(), frame.height(), options.trimFrames);
+    if (!options.frameStore)
+        return true;
+
+    // A frame with the same content (in this resource, another one or another archive) is written once
+    key = frameContentKey(indexedData, frame.width(), frame.height(), job.regions[i], paletteHash, options.bitmapMode);
+    job.frameKeys[i] = key;
+    std::string framePath = graphicsFramePath(job, i);
+    std::string existing;
+    FrameStore::Claim claim = options.frameStore->claim(key, graphicsFrameRank(job, i, options), framePath, existing);
+    if (claim == FrameStore::Claim::Write)
+        return true;
+
+    // The writer links once the first copy is on disk, joined frames get linked by the frame writing it
+    if (claim == FrameStore::Claim::Link && existing != framePath) {
+        bool linked = true;
+        if (options.writer) {
+            options.writer->submitLink(existing, framePath);
+        }
+        else {
+            linked = linkOutputFile(existing, framePath);
+        }
+        if (!linked)
+            return true;
     }
 
-    // Keep searching until we reach the end of the file
-    while (position < fileBuffer.size()) {
-        size_t headerPos = findHeader(&fileBuffer[position], fileBuffer.size() - position);
+    options.frameStore->countDuplicate();
+    job.extractedFrames++;
+    return false;
+}
 
-        if (headerPos == SIZE_MAX) {
-            break;
+void encodeGraphicsFrame(ResourceJob& job, uint16_t i, uint64_t key, const PaletteLUT& paletteLUT, const ExtractionOptions& options) {
+    std::string framePath = graphicsFramePath(job, i);
+    const uint8_t* indexedData = graphicsFrameData(job, i);
+    const uint32_t width = job.view.frame(i).width();
+    if (!options.frameStore) {
+        if (writeFrameBMP(indexedData, width, job.regions[i], framePath, paletteLUT, options.bitmapMode, options.writer)) {
+            job.extractedFrames++;
         }
+        return;
+    }
 
-        // Calculate absolute position
-        size_t fileStart = position + headerPos;
+    // Identical frames claimed meanwhile may rank lower, the file goes under the lowest ranked path
+    std::vector<uint8_t> bmp = encodeFrameBMP(indexedData, width, job.regions[i], paletteLUT, options.bitmapMode);
+    const std::string target = options.frameStore->beginPublish(key, framePath);
+    bool written = true;
+    if (options.writer) {
+        options.writer->submit(target, std::move(bmp));
+    }
+    else {
+        written = writeOutputFile(target, bmp.data(), bmp.size());
+    }
 
-        size_t minHeaderSize = 16; // Minimum bytes needed to read header and size
-        if (fileStart + minHeaderSize > fileBuffer.size()) {
-            break;
+    // Links to it are submitted after it, so the writer holds them until it's on disk. Without a writer a
+    // failed copy leaves every frame to be written on its own.
+    bool extracted = written && target == framePath;
+    for (const std::string& path : options.frameStore->finishPublish(key, target, written)) {
+        bool done = true;
+        if (options.writer) {
+            options.writer->submitLink(target, path);
         }
-
-        // This will happen if our current buffer is too small for the file size.
-        // TODO: reload the buffer while keeping the current data to avoid truncating files
-        // For most files it shouldn't be an issue
-        uint32_t fileSize = getSize(&fileBuffer[fileStart]);
-        if (fileStart + fileSize > fileBuffer.size()) {
-            std::cout << "Warning: " << info.name << " file appears truncated. Requested size: " << fileSize
-                << ", but only " << (fileBuffer.size() - fileStart) << " bytes available." << std::endl;
-            fileSize = fileBuffer.size() - fileStart;
+        else {
+            done = (written && linkOutputFile(target, path)) || writeOutputFile(path, bmp.data(), bmp.size());
         }
+        if (path == framePath) {
+            extracted = done;
+        }
+    }
+    if (extracted) {
+        job.extractedFrames++;
+    }
+}
 
-        std::cout << "Found " << info.name << " file at position " << fileStart
-            << ", size: " << fileSize << " bytes" << std::endl;
-
-        // Create resource raw file
-        std::string resourceFileName = subfolder + "/" + info.extension + "_" + std::to_string(fileCount++) + "." + info.extension;
-        std::ofstream resourceFile(resourceFileName, std::ios::binary);
+void encodeGraphicsSpritesheet(ResourceJob& job, const PaletteLUT& paletteLUT, const ExtractionOptions& options) {
+    job.spritesheetCreated = extractFramesToSpritesheet(job.view, job.spritesheetPath, paletteLUT, options.bitmapMode,
+        options.atlasMaxPageSize, options.trimFrames, job.spritesheetLog, options.writer, &job.spritesheetFiles);
+}
 
-        if (!resourceFile) {
-            std::cerr << "Failed to create output file: " << resourceFileName << std::endl;
-            continue;
+// Trim metadata and the summary of a graphics resource, once all of its parts are done
+void finishGraphicsResource(ResourceJob& job, const ExtractionOptions& options) {
+    if (options.extractIndividualFrames) {
+        // Every frame has claimed its content by now, links are the frames that aren't the lowest ranked copy
+        int linkedFrames = 0;
+        if (options.frameStore) {
+            for (size_t i = 0; i < job.frameKeys.size(); ++i) {
+                if (!options.frameStore->isCanonical(job.frameKeys[i], graphicsFrameRank(job, static_cast<uint16_t>(i), options))) {
+                    ++linkedFrames;
+                }
+            }
+        }
+        if (linkedFrames > 0) {
+            job.log << "  " << linkedFrames << " frames were identical to frames written before and got linked to them" << std::endl;
         }
 
-        resourceFile.write(&fileBuffer[fileStart], fileSize);
-        resourceFile.close();
+        // Trimmed frames lose their position, keep it next to them
+        if (options.trimFrames) {
+            std::ostringstream trimFile;
+            trimFile << "{\n  \"frames\": [\n";
+            for (size_t i = 0; i < job.regions.size(); ++i) {
+                trimFile << "    {\"frame\": " << i << ", \"file\": \"frame_" << i << ".bmp\""
+                    << ", \"trimX\": " << job.regions[i].x << ", \"trimY\": " << job.regions[i].y
+                    << ", \"width\": " << job.regions[i].width << ", \"height\": " << job.regions[i].height << "}"
+                    << (i + 1 < job.regions.size() ? "," : "") << "\n";
+            }
+            trimFile << "  ]\n}\n";
+            writeTextOutput(job.framesFolder + "/frames.json", trimFile.str(), options.writer);
+        }
 
-        std::cout << "Extracted raw resource to " << resourceFileName << std::endl;
+        job.log << "  Extracted " << job.extractedFrames << " frames as BMP files to " << job.framesFolder << std::endl;
+    }
 
-        // Special handling for D3GR format
-        if (format == FileFormat::D3GR) {
-            std::string framesFolder = subfolder + "/frames_" + std::to_string(fileCount - 1);
-            std::filesystem::create_directory(framesFolder);
+    if (options.extractSpritesheet) {
+        job.log << job.spritesheetLog.str();
+        if (job.spritesheetCreated) {
+            job.log << "  Extracted spritesheet atlas to " << job.spritesheetPath << ".json" << std::endl;
+        }
+        else {
+            job.log << "  Failed to create spritesheet" << std::endl;
+        }
+    }
 
-            uint16_t d3grFrameCount = static_cast<uint16_t>(
-                static_cast<uint8_t>(fileBuffer[fileStart + 0x18]) |
-                (static_cast<uint8_t>(fileBuffer[fileStart + 0x19]) << 8)
-                );
+    job.frameCount = job.extractedFrames;
+}
 
-            std::cout << "  Resource contains " << d3grFrameCount << " frames" << std::endl;
+// Marks a part of a graphics resource as done, the last one finishes the resource
+void finishGraphicsResourcePart(ResourceJob& job, const ExtractionOptions& options) {
+    if (job.pendingParts.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        finishGraphicsResource(job, options);
+    }
+}
 
-            // Extract each frame if individual frames are requested
-            if (extractIndividualFrames) {
-                int extractedFrames = 0;
-                for (uint16_t i = 0; i < d3grFrameCount; ++i) {
-                    std::string framePath = framesFolder + "/frame_" + std::to_string(i) + ".bmp";
+// Extracts the frames of a D3GR resource after its raw copy has been written
+// Frames are spread over options.pool, the spritesheet is built next to them
+int extractGraphicsResourceContents(std::span<const std::byte> resource, const std::string& subfolder, int resourceIndex, const ExtractionOptions& options, const PaletteLUT& paletteLUT, std::ostream& log) {
+    ResourceJob job;
+    job.resourceIndex = resourceIndex;
+    job.data = reinterpret_cast<const char*>(resource.data());
+    job.size = static_cast<uint32_t>(resource.size());
+    if (beginGraphicsResource(job, subfolder, options) == 0) {
+        finishGraphicsResource(job, options);
+    }
 
-                    if (extractFrameToBMP(&fileBuffer[fileStart], i, framePath, palette)) {
-                        extractedFrames++;
-                        frameCount++;
-                    }
-                }
+    // Extract frames as spritesheet if requested
+    TaskGroup spritesheetTask;
+    auto createSpritesheet = [&] {
+        encodeGraphicsSpritesheet(job, paletteLUT, options);
+        finishGraphicsResourcePart(job, options);
+    };
+    if (options.extractSpritesheet) {
+        if (options.pool) {
+            options.pool->submit(spritesheetTask, createSpritesheet);
+        }
+        else {
+            createSpritesheet();
+        }
+    }
 
-                std::cout << "  Extracted " << extractedFrames << " frames as BMP files to " << framesFolder << std::endl;
+    // Extract each frame if individual frames are requested
+    if (options.extractIndividualFrames) {
+        uint64_t paletteHash = hashBytes(paletteLUT.bgra, sizeof(paletteLUT.bgra));
+        auto extractFrame = [&](uint16_t i) {
+            uint64_t key = 0;
+            if (decodeGraphicsFrame(job, i, paletteHash, options, key)) {
+                encodeGraphicsFrame(job, i, key, paletteLUT, options);
             }
-
-            // Extract frames as spritesheet if requested
-            if (extractSpritesheet) {
-                std::string spritesheetPath = subfolder + "/spritesheet_" + std::to_string(fileCount - 1) + ".bmp";
-                if (extractFramesToSpritesheet(&fileBuffer[fileStart], spritesheetPath, palette)) {
-                    std::cout << "  Extracted spritesheet to " << spritesheetPath << std::endl;
-                }
-                else {
-                    std::cout << "  Failed to create spritesheet" << std::endl;
+            finishGraphicsResourcePart(job, options);
+        };
+
+        if (options.pool) {
+            // A few frames per task, single frames are too small to be worth a task each
+            options.pool->parallelFor(job.view.frameCount(), 8, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    extractFrame(static_cast<uint16_t>(i));
                 }
+                });
+        }
+        else {
+            for (size_t i = 0; i < job.view.frameCount(); ++i) {
+                extractFrame(static_cast<uint16_t>(i));
             }
         }
-
-        // Move to the end of this file for next search
-        position = fileStart + fileSize;
     }
 
-    std::cout << "Extracted " << fileCount << " " << info.name << " files" << std::endl;
-    if (format == FileFormat::D3GR && frameCount > 0) {
-        std::cout << "Total frames extracted: " << frameCount << std::endl;
+    if (options.extractSpritesheet && options.pool) {
+        options.pool->wait(spritesheetTask);
     }
-    return fileCount > 0;
+
+    log << job.log.str();
+    return job.frameCount;
 }
 
-// -- PALETTE DATA --
-// TODO: Move this to the top along with all other enums/structs/etc. Keeping this close for now
-std::map<std::string, std::vector<uint8_t>> filenameToPalette = {
-    {"RES.006", generateSanitariumPalette(paletteDataRes006)},
-    {"RES.007", generateSanitariumPalette(paletteDataRes007)},
-    {"RES.008", generateSanitariumPalette(paletteDataRes006)},
-    {"RES.009", generateSanitariumPalette(paletteDataRes006)}
+// -- FORMAT REGISTRY --
+// Every format that can be carved. Signatures of all the selected formats are searched for in one pass.
+// Header patterns come from kFileFormats (headers/FileFormats.h), so a new format only needs its pattern
+// there and its size/extract handlers here to get the SIMD scan path.
+const std::map<FileFormat, FormatInfo> formatInfoMap = {
+    {FileFormat::WAV, {"WAV Audio", "wav", "extracted_wav",
+        kWavSignature, WavView::measure, WavView::headerSize, nullptr, nullptr}},
+    {FileFormat::D3GR, {"D3GR (Sanitarium Graphic Resource file)", "d3gr", "extracted_gr",
+        kGraphicsResourceSignature, D3GRView::measure, D3GRView::headerSize, indexGraphicsResourceFrames, extractGraphicsResourceContents}}
 };
 
+// State of one extraction run, shared by the mapped and streaming paths
+struct CarveSession {
+    std::vector<const FormatInfo*> infos;   // Indexed like the patterns of the signature set
+    SignatureSet signatures;
+    std::vector<std::string> subfolders;
+    std::vector<int> fileCounts;
+    std::vector<int> frameCounts;           // For counting total frames (for D3GR)
+    PaletteLUT paletteLUT;                  // options.palette packed once for every frame of the run
+    bool inputMapped = false;               // Resource data stays valid until the run ends, the writer can use it in place
+    int inputFd = -1;                       // The mapped archive, raw copies are made by the kernel from it
+};
 
-int main() {
-    std::string filename = "";
-    bool extractIndividualFrames = true;  // Default to true for backward compatibility
-    bool extractSpritesheet = false;     // Default to false
-    // Defaulting palette value to the one for RES.006
-	std::vector<uint8_t> palette = generateSanitariumPalette(paletteDataRes007);
+CarveSession beginCarveSession(const std::string& filename, const std::vector<FileFormat>& formats, const ExtractionOptions& options) {
+    CarveSession session;
+    session.paletteLUT = buildPaletteLUT(options.palette);
+    std::vector<SignaturePattern> patterns;
 
-    while (true) {
-        std::cout << "Enter the filename to scan (type EXIT to close the program): ";
-        std::getline(std::cin, filename);
+    std::string cleanFilename = cleanFolderName(filename);
+    for (FileFormat format : formats) {
+        const FormatInfo& info = formatInfoMap.at(format);
+        *options.log << "Searching for " << info.name << " files..." << std::endl;
+
+        createOutputDirectory(info.folderName, options);
+        std::string subfolder = info.folderName + "/" + cleanFilename;
+        createOutputDirectory(subfolder, options);
+
+        session.infos.push_back(&info);
+        patterns.push_back(info.signature);
+        session.subfolders.push_back(subfolder);
+        session.fileCounts.push_back(0);
+        session.frameCounts.push_back(0);
+    }
 
-        if (filename == "EXIT") {
-	        std::cout << "Exiting program..." << std::endl;
-	        break;
-        }
-        else {
-            auto it = filenameToPalette.find(filename);
-            if (it != filenameToPalette.end()) {
-                std::vector<uint8_t> palette = it->second;
-                std::cout << "Palette for " << filename << " has been set.\n";
-            }
-            else {
-                std::cout << "No palette found for " << filename << ".\n";
-            }
-        }
+    session.signatures = buildSignatureSet(patterns);
+    return session;
+}
 
-        // Display available formats to extract
-        std::cout << "\nAvailable formats to extract:" << std::endl;
-        int i = 1;
-        for (const auto& format : formatInfoMap) {
-            std::cout << i++ << ". " << format.second.name << " (." << format.second.extension << ")" << std::endl;
-        }
+// Path of the raw copy of a resource
+std::string resourceOutputPath(const CarveSession& session, size_t formatIndex, int resourceIndex) {
+    const FormatInfo& info = *session.infos[formatIndex];
+    return session.subfolders[formatIndex] + "/" + info.extension + "_" + std::to_string(resourceIndex) + "." + info.extension;
+}
 
-        // Get user choice
-        int choice = 0;
-        std::string choiceStr;
-        while (choice < 1 || choice > formatInfoMap.size()) {
-            std::cout << "\nSelect format to extract (1-" << formatInfoMap.size() << "): ";
-            std::getline(std::cin, choiceStr);
+void logFoundResource(const FormatInfo& info, size_t fileStart, uint32_t fileSize, std::ostream& log) {
+    log << "Found " << info.name << " file at position " << fileStart
+        << ", size: " << fileSize << " bytes" << std::endl;
+}
 
-            try {
-                choice = std::stoi(choiceStr);
-            }
-            catch (...) {
-                choice = 0;
-            }
-        }
+// Logs a resource held in memory and writes its raw copy, unless raw export is turned off
+// Only reads the session, so resources can be written concurrently once their index has been handed out
+bool writeResourceCopy(const CarveSession& session, size_t formatIndex, int resourceIndex, const char* data, uint32_t fileSize, size_t fileStart,
+    const ExtractionOptions& options, std::ostream& log) {
+    const FormatInfo& info = *session.infos[formatIndex];
+
+    logFoundResource(info, fileStart, fileSize, log);
+    if (!options.exportRawResources)
+        return true;
+
+    // Create resource raw file
+    std::string resourceFileName = resourceOutputPath(session, formatIndex, resourceIndex);
+    if (options.writer && session.inputMapped) {
+        // Copied file to file where the kernel can, the mapped bytes otherwise
+        options.writer->submitRange(resourceFileName, session.inputFd, fileStart, data, fileSize);
+    }
+    else if (options.writer) {
+        // Streaming reuses the window, the writer gets its own copy
+        options.writer->submit(resourceFileName, std::vector<uint8_t>(data, data + fileSize));
+    }
+    else if (!writeOutputFile(resourceFileName, data, fileSize)) {
+        std::cerr << "Failed to create output file: " << resourceFileName << std::endl;
+        return false;
+    }
 
-        // Convert choice to format enum
-        FileFormat selectedFormat = static_cast<FileFormat>(choice - 1);
+    log << "Extracted raw resource to " << resourceFileName << std::endl;
+    return true;
+}
 
-        // If D3GR format was selected, ask for extraction options
-        if (selectedFormat == FileFormat::D3GR) {
-            std::cout << "\nD3GR extraction options:" << std::endl;
-            std::cout << "1. Extract individual frames" << std::endl;
-            std::cout << "2. Extract spritesheet" << std::endl;
-            std::cout << "3. Extract both" << std::endl;
+// Writes the raw copy of a resource and runs its format's content handler, returns the frames extracted
+int writeResource(const CarveSession& session, size_t formatIndex, int resourceIndex, const char* data, uint32_t fileSize, size_t fileStart,
+    const ExtractionOptions& options, std::ostream& log) {
+    const FormatInfo& info = *session.infos[formatIndex];
+    if (!writeResourceCopy(session, formatIndex, resourceIndex, data, fileSize, fileStart, options, log))
+        return 0;
 
-            int extractOption = 0;
-            while (extractOption < 1 || extractOption > 3) {
-                std::cout << "Select option (1-3): ";
-                std::getline(std::cin, choiceStr);
+    // Format specific handling (frames for D3GR)
+    if (info.extractContents) {
+        return info.extractContents(asBytes(data, fileSize), session.subfolders[formatIndex], resourceIndex, options, session.paletteLUT, log);
+    }
+    return 0;
+}
 
-                try {
-                    extractOption = std::stoi(choiceStr);
-                }
-                catch (...) {
-                    extractOption = 0;
-                }
-            }
+// Extracts a resource right away, numbering it after the ones extracted before
+void extractResource(CarveSession& session, size_t formatIndex, const char* data, uint32_t fileSize, size_t fileStart, const ExtractionOptions& options) {
+    int resourceIndex = session.fileCounts[formatIndex]++;
+    session.frameCounts[formatIndex] += writeResource(session, formatIndex, resourceIndex, data, fileSize, fileStart, options, *options.log);
+}
 
-            // Set extraction flags based on user choice
-            switch (extractOption) {
-            case 1:
-                extractIndividualFrames = true;
-                extractSpritesheet = false;
-                break;
-            case 2:
-                extractIndividualFrames = false;
-                extractSpritesheet = true;
-                break;
-            case 3:
-                extractIndividualFrames = true;
-                extractSpritesheet = true;
-                break;
-            }
+bool finishCarveSession(const CarveSession& session, const ExtractionOptions& options) {
+    std::ostream& log = *options.log;
+    int totalFiles = 0;
+    for (size_t i = 0; i < session.infos.size(); ++i) {
+        log << "Extracted " << session.fileCounts[i] << " " << session.infos[i]->name << " files" << std::endl;
+        if (session.frameCounts[i] > 0) {
+            log << "Total frames extracted: " << session.frameCounts[i] << std::endl;
         }
+        totalFiles += session.fileCounts[i];
+        if (options.stats) {
+            options.stats->resources += session.fileCounts[i];
+            options.stats->frames += session.frameCounts[i];
+        }
+    }
+    return totalFiles > 0;
+}
 
-        // Extract files of the chosen format
-        bool success = extractFiles(filename, selectedFormat, extractIndividualFrames, extractSpritesheet, palette);
-
-        if (success) {
-            std::cout << "Extraction completed successfully!" << std::endl;
+// -- STREAMING EXTRACTION --
+// Carves the input through a window of options.streamWindowSize bytes. The last bytes of a window are
+// kept when it's refilled so signatures cut by the window end are still found, and the window grows
+// up to options.memoryLimit so a resource that spans windows can be handed whole to its handlers.
+// Resources without a content handler, or larger than the limit, are copied through the window instead.
+bool extractFilesStreaming(std::istream& stream, const std::string& filename, const std::vector<FileFormat>& formats, const ExtractionOptions& options) {
+    const size_t windowSize = std::max(options.streamWindowSize, size_t(4096));
+    const size_t memoryLimit = std::max(options.memoryLimit, windowSize);
+
+    std::vector<char> window(windowSize);
+    size_t windowStart = 0; // Absolute offset of window[0]
+    size_t windowFill = 0;
+    bool endOfStream = false;
+
+    // Tops up the window from the stream
+    auto fill = [&]() {
+        while (windowFill < window.size() && !endOfStream) {
+            stream.read(window.data() + windowFill, window.size() - windowFill);
+            windowFill += static_cast<size_t>(stream.gcount());
+            if (!stream)
+                endOfStream = true;
         }
-        else {
-            std::cout << "No files were extracted." << std::endl;
+    };
+
+    // Drops the first count bytes of the window
+    auto discard = [&](size_t count) {
+        std::memmove(window.data(), window.data() + count, windowFill - count);
+        windowFill -= count;
+        windowStart += count;
+    };
+
+    // Makes count bytes from window[base] available, moving them to the front and growing the window if needed
+    auto ensureAvailable = [&](size_t& base, size_t count) {
+        if (base + count <= windowFill)
+            return true;
+
+        if (base > 0) {
+            discard(base);
+            base = 0;
+        }
+        if (count > window.size() && count <= memoryLimit) {
+            window.resize(count);
         }
+        fill();
+        return windowFill >= count;
+    };
 
-        // Add a visual separator between extraction sessions
-        std::cout << "\n----------------------------------------\n" << std::endl;
+    fill();
+    if (windowFill == 0) {
+        std::cerr << "File is empty" << std::endl;
+        return false;
     }
-    return 0;
-}
\ No newline at end of file
+
+    *options.log << "Streaming input in " << windowSize << " byte windows (memory limit: " << memoryLimit << " bytes)" << std::endl;
+
+    CarveSession session = beginCarveSession(filename, formats, options);
+    const size_t overlap = session.signatures.maxLength - 1;
+    size_t scanPos = 0;
+
+    while (true) {
+        size_t formatIndex = 0;
+        size_t headerPos = findNextSignature(session.signatures, window.data() + scanPos, windowFill - scanPos, formatIndex);
+
+        // Until the stream ends, only accept hits where the longest signature fits in the window,
+        // an earlier one could still be waiting behind the window end
+        if (headerPos != SIZE_MAX && !endOfStream && scanPos + headerPos + session.signatures.maxLength > windowFill) {
+            headerPos = SIZE_MAX;
+        }
+
+        if (headerPos == SIZE_MAX) {
+            if (endOfStream)
+                break;
+
+            // Keep the overlap, everything before it has been fully scanned
+            size_t keepFrom = std::max(scanPos, windowFill > overlap ? windowFill - overlap : 0);
+            discard(keepFrom);
+            if (window.size() > windowSize) {
+                window.resize(windowSize);
+                window.shrink_to_fit();
+            }
+            fill();
+            scanPos = 0;
+            continue;
+        }
+
+        const FormatInfo& info = *session.infos[formatIndex];
+        size_t base = scanPos + headerPos;
+
+        size_t minHeaderSize = 16; // Minimum bytes needed to read header and size
+        if (!ensureAvailable(base, minHeaderSize)) {
+            break;
+        }
+
+        // Load everything the size handler reads
+        size_t headerSize = info.getHeaderSize(asBytes(window.data() + base, windowFill - base));
+        while (headerSize > windowFill - base && ensureAvailable(base, headerSize)) {
+            headerSize = info.getHeaderSize(asBytes(window.data() + base, windowFill - base));
+        }
+        if (headerSize > windowFill - base) {
+            *options.log << "Warning: skipping " << info.name << " header at position " << (windowStart + base)
+                << ", its header doesn't fit in the input or the memory limit" << std::endl;
+            scanPos = base + 1;
+            continue;
+        }
+
+        const size_t fileStart = windowStart + base;
+        uint32_t fileSize = info.getSize(asBytes(window.data() + base, windowFill - base));
+        if (fileSize == 0) {
+            *options.log << "Warning: skipping " << info.name << " header at position " << fileStart
+                << ", it isn't a valid resource" << std::endl;
+            scanPos = base + 1;
+            continue;
+        }
+
+        // Handlers that need the whole resource get it in memory, as long as it fits the limit
+        if (fileSize <= window.size() || (info.extractContents && fileSize <= memoryLimit)) {
+            if (!ensureAvailable(base, fileSize)) {
+                *options.log << "Warning: " << info.name << " file appears truncated. Requested size: " << fileSize
+                    << ", but only " << (windowFill - base) << " bytes available." << std::endl;
+                fileSize = static_cast<uint32_t>(windowFill - base);
+            }
+
+            extractResource(session, formatIndex, window.data() + base, fileSize, fileStart, options);
+
+            // Move to the end of this file for next search
+            scanPos = base + fileSize;
+            continue;
+        }
+
+        // Copy the resource through the window without holding it whole
+        logFoundResource(info, fileStart, fileSize, *options.log);
+
+        int resourceIndex = session.fileCounts[formatIndex]++;
+        std::string resourceFileName = resourceOutputPath(session, formatIndex, resourceIndex);
+        std::ofstream resourceFile;
+        // Without raw export the resource is only read past
+        const bool exportRaw = options.exportRawResources;
+        if (exportRaw && options.writer) {
+            // Created empty, every piece is appended in order
+            options.writer->submit(resourceFileName, {});
+        }
+        else if (exportRaw) {
+            resourceFile.open(resourceFileName, std::ios::binary);
+            if (!resourceFile) {
+                std::cerr << "Failed to create output file: " << resourceFileName << std::endl;
+            }
+        }
+
+        size_t remaining = fileSize;
+        while (remaining > 0) {
+            if (base == windowFill) {
+                if (endOfStream)
+                    break;
+                discard(base);
+                base = 0;
+                fill();
+                continue;
+            }
+
+            size_t chunk = std::min(remaining, windowFill - base);
+            if (exportRaw && options.writer) {
+                options.writer->submitAppend(resourceFileName, std::vector<uint8_t>(window.data() + base, window.data() + base + chunk));
+            }
+            else if (resourceFile) {
+                resourceFile.write(window.data() + base, chunk);
+            }
+            base += chunk;
+            remaining -= chunk;
+        }
+        resourceFile.close();
+
+        if (remaining > 0) {
+            *options.log << "Warning: " << info.name << " file appears truncated. Requested size: " << fileSize
+                << ", but only " << (fileSize - remaining) << " bytes available." << std::endl;
+        }
+        if (exportRaw) {
+            *options.log << "Extracted raw resource to " << resourceFileName << std::endl;
+        }
+        if (info.extractContents) {
+            *options.log << "  Resource is larger than the memory limit, "
+                << (exportRaw ? "only the raw copy was extracted" : "nothing was extracted") << std::endl;
+        }
+
+        scanPos = base;
+    }
+
+    if (options.writer) {
+        options.writer->flush();
+    }
+    return finishCarveSession(session, options);
+}
+
+// -- RESOURCE INDEX --
+uint32_t formatMaskOf(const std::vector<FileFormat>& formats) {
+    uint32_t mask = 0;
+    for (FileFormat format : formats) {
+        mask |= 1u << static_cast<uint32_t>(format);
+    }
+    return mask;
+}
+
+// Scans a mapped archive and lists every resource, in the order and with the sizes extraction uses
+// onResource sees every resource as soon as it's found, the scan stops early after the resource isLast returns true for
+ResourceIndex buildResourceIndex(const char* fileData, size_t archiveSize, const std::vector<FileFormat>& formats, unsigned scanThreads, std::ostream& log = std::cout,
+    const std::function<void(const IndexedResource&)>& onResource = nullptr, const std::function<bool(const IndexedResource&)>& isLast = nullptr) {
+    ResourceIndex index;
+    index.archiveSize = archiveSize;
+    index.formatMask = formatMaskOf(formats);
+
+    std::vector<SignaturePattern> patterns;
+    for (FileFormat format : formats) {
+        patterns.push_back(formatInfoMap.at(format).signature);
+    }
+    const SignatureSet signatures = buildSignatureSet(patterns);
+
+    // With several threads every chunk of the archive is scanned up front and the hits are resolved
+    // in order below. A single thread scans lazily and never looks inside carved resources.
+    if (scanThreads == 0) {
+        scanThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<SignatureHit> hits;
+    size_t nextHit = 0;
+    if (scanThreads > 1) {
+        hits = findAllSignatures(signatures, fileData, archiveSize, scanThreads);
+    }
+
+    // Next header at or after position, skipping hits inside the payload of an earlier resource
+    auto findNextHeader = [&](size_t position, size_t& formatIndex) -> size_t {
+        if (scanThreads > 1) {
+            while (nextHit < hits.size() && hits[nextHit].offset < position) {
+                ++nextHit;
+            }
+            if (nextHit == hits.size())
+                return SIZE_MAX;
+
+            formatIndex = hits[nextHit].patternIndex;
+            return hits[nextHit].offset;
+        }
+
+        size_t headerPos = findNextSignature(signatures, fileData + position, archiveSize - position, formatIndex);
+        return headerPos == SIZE_MAX ? SIZE_MAX : position + headerPos;
+    };
+
+    size_t position = 0;
+
+    // Keep searching until we reach the end of the file
+    while (position < archiveSize) {
+        size_t formatIndex = 0;
+        size_t fileStart = findNextHeader(position, formatIndex);
+
+        if (fileStart == SIZE_MAX) {
+            break;
+        }
+
+        const FormatInfo& info = formatInfoMap.at(formats[formatIndex]);
+
+        size_t minHeaderSize = 16; // Minimum bytes needed to read header and size
+        if (fileStart + minHeaderSize > archiveSize) {
+            break;
+        }
+
+        const std::span<const std::byte> available = asBytes(fileData + fileStart, archiveSize - fileStart);
+        if (info.getHeaderSize(available) > available.size()) {
+            log << "Warning: skipping " << info.name << " header at position " << fileStart
+                << ", its header doesn't fit in the archive" << std::endl;
+            position = fileStart + 1;
+            continue;
+        }
+
+        uint32_t fileSize = info.getSize(available);
+        if (fileSize == 0) {
+            log << "Warning: skipping " << info.name << " header at position " << fileStart
+                << ", it isn't a valid resource" << std::endl;
+            position = fileStart + 1;
+            continue;
+        }
+
+        // The whole archive is visible here, so this only happens when the archive itself is cut short
+        if (fileStart + fileSize > archiveSize) {
+            log << "Warning: " << info.name << " file appears truncated. Requested size: " << fileSize
+                << ", but only " << (archiveSize - fileStart) << " bytes available." << std::endl;
+            fileSize = archiveSize - fileStart;
+        }
+
+        IndexedResource resource = { fileStart, fileSize, static_cast<uint32_t>(index.frames.size()), 0, static_cast<uint8_t>(formats[formatIndex]) };
+        if (info.indexFrames) {
+            info.indexFrames(available.first(fileSize), index.frames);
+            resource.frameCount = static_cast<uint16_t>(index.frames.size() - resource.firstFrame);
+        }
+        index.resources.push_back(resource);
+        if (onResource) {
+            onResource(resource);
+        }
+        if (isLast && isLast(resource)) {
+            break;
+        }
+
+        // Move to the end of this file for next search
+        position = fileStart + fileSize;
+    }
+
+    return index;
+}
+
+// Sidecar index of an archive, its name lists the formats in registry order, e.g. RES.006.wav-d3gr.toc
+std::string archiveIndexPath(const std::string& filename, const std::vector<FileFormat>& formats) {
+    std::string formatsTag;
+    for (const auto& format : formatInfoMap) {
+        if (std::find(formats.begin(), formats.end(), format.first) != formats.end()) {
+            formatsTag += (formatsTag.empty() ? "" : "-") + format.second.extension;
+        }
+    }
+    return resourceIndexPath(filename, formatsTag);
+}
+
+// Reads the sidecar index of a mapped archive, false when there is none or it doesn't match the archive anymore
+bool loadCurrentResourceIndex(const std::string& filename, const char* fileData, size_t archiveSize, const std::vector<FileFormat>& formats, const ExtractionOptions& options,
+    ResourceIndex& index) {
+    const std::string indexPath = archiveIndexPath(filename, formats);
+    if (!options.useIndex || !readResourceIndex(indexPath, index) || index.formatMask != formatMaskOf(formats) ||
+        !isResourceIndexCurrent(index, filename, fileData, archiveSize))
+        return false;
+
+    // Entries are trusted from here on, so make sure they stay inside the archive
+    bool inRange = std::all_of(index.resources.begin(), index.resources.end(), [&](const IndexedResource& resource) {
+        return resource.offset <= archiveSize && resource.size <= archiveSize - resource.offset;
+        });
+    if (!inRange)
+        return false;
+
+    *options.log << "Using resource index " << indexPath << " (" << index.resources.size() << " resources)" << std::endl;
+
+    // Accepted on its hash after the archive was touched, store the new time so the next run skips hashing
+    int64_t modified = fileModifiedTime(filename);
+    if (options.writeIndex && index.archiveModified != modified) {
+        index.archiveModified = modified;
+        writeResourceIndex(indexPath, index);
+    }
+    return true;
+}
+
+// Loads the sidecar index of a mapped archive when it's current, or scans the archive and writes a new one
+ResourceIndex loadResourceIndex(const std::string& filename, const char* fileData, size_t archiveSize, const std::vector<FileFormat>& formats, const ExtractionOptions& options,
+    const std::function<void(const IndexedResource&)>& onResource = nullptr) {
+    ResourceIndex index;
+    if (loadCurrentResourceIndex(filename, fileData, archiveSize, formats, options, index)) {
+        if (onResource) {
+            std::for_each(index.resources.begin(), index.resources.end(), onResource);
+        }
+        return index;
+    }
+
+    const std::string indexPath = archiveIndexPath(filename, formats);
+    index = buildResourceIndex(fileData, archiveSize, formats, options.scanThreads, *options.log, onResource);
+
+    if (options.writeIndex) {
+        index.archiveModified = fileModifiedTime(filename);
+        index.archiveHash = hashBytes(fileData, archiveSize);
+        if (!writeResourceIndex(indexPath, index)) {
+            std::cerr << "Failed to write resource index: " << indexPath << std::endl;
+        }
+    }
+    return index;
+}
+
+// Prints the resources of an archive, from its index when there is a current one
+bool listArchiveResources(const std::string& filename, const std::vector<FileFormat>& formats, const ExtractionOptions& options = ExtractionOptions()) {
+    InputSource input;
+    if (!input.open(filename) || input.size() == 0) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    ResourceIndex index = loadResourceIndex(filename, input.data(), input.size(), formats, options);
+    for (size_t i = 0; i < index.resources.size(); ++i) {
+        const IndexedResource& resource = index.resources[i];
+        const FormatInfo& info = formatInfoMap.at(static_cast<FileFormat>(resource.format));
+
+        std::cout << i << ". " << info.extension << " at position " << resource.offset << ", size: " << resource.size << " bytes";
+        if (resource.frameCount > 0) {
+            std::cout << ", " << resource.frameCount << " frames";
+        }
+        std::cout << std::endl;
+
+        for (uint16_t f = 0; f < resource.frameCount; ++f) {
+            const IndexedFrame& frame = index.frames[resource.firstFrame + f];
+            std::cout << "    frame " << f << ": " << frame.width << "x" << frame.height << " at +" << frame.offset << std::endl;
+        }
+    }
+    return !index.resources.empty();
+}
+
+// -- SINGLE RESOURCE LOOKUP --
+// One resource of an archive, asked for by its number in --list order or by a position inside it
+struct ResourceQuery {
+    uint32_t resourceNumber = 0;
+    std::optional<uint64_t> offset;     // Used instead of resourceNumber when set
+};
+
+// Finds one resource of a mapped archive without carving the rest of it. The current index sidecar answers when
+// there is one, otherwise the archive is scanned from the start only as far as the resource.
+bool findArchiveResource(const std::string& filename, const InputSource& input, const std::vector<FileFormat>& formats, const ResourceQuery& query,
+    const ExtractionOptions& options, IndexedResource& found, uint32_t& foundNumber) {
+    auto matches = [&](const IndexedResource& resource, size_t number) {
+        return query.offset ? *query.offset >= resource.offset && *query.offset - resource.offset < resource.size : number == query.resourceNumber;
+    };
+
+    ResourceIndex index;
+    if (!loadCurrentResourceIndex(filename, input.data(), input.size(), formats, options, index)) {
+        // A single thread scans lazily, so nothing past the resource is looked at
+        size_t scanned = 0;
+        index = buildResourceIndex(input.data(), input.size(), formats, 1, *options.log, nullptr, [&](const IndexedResource& resource) {
+            return query.offset ? resource.offset + resource.size > *query.offset : scanned++ == query.resourceNumber;
+            });
+    }
+
+    // Resources are in archive order, so an offset is found by a binary search like a number is by position
+    size_t number = query.resourceNumber;
+    if (query.offset) {
+        auto after = std::upper_bound(index.resources.begin(), index.resources.end(), *query.offset,
+            [](uint64_t offset, const IndexedResource& resource) { return offset < resource.offset; });
+        number = after == index.resources.begin() ? index.resources.size() : static_cast<size_t>(after - index.resources.begin()) - 1;
+    }
+    if (number >= index.resources.size() || !matches(index.resources[number], number))
+        return false;
+
+    found = index.resources[number];
+    foundNumber = static_cast<uint32_t>(number);
+    return true;
+}
+
+// BMP of one frame of a D3GR resource in memory, as extraction would write it with the palette LUT
+std::vector<uint8_t> encodeResourceFrame(const D3GRView& resource, uint32_t frameIndex, const PaletteLUT& paletteLUT, BitmapMode mode = BitmapMode::TrueColor, bool trim = false) {
+    if (frameIndex >= resource.frameCount())
+        return {};
+
+    const FrameView& frame = resource.frame(frameIndex);
+    FrameBounds region = frameRegion(frame.indices(), frame.width(), frame.height(), trim);
+    return encodeFrameBMP(frame.indices(), frame.width(), region, paletteLUT, mode);
+}
+
+// Writes one resource of an archive, or one frame of it as a BMP, to outputPath without carving the rest of the archive.
+// An empty outputPath names it after the archive (e.g. RES_007_12_frame_3.bmp), "-" writes it to stdout, options.log
+// mustn't be std::cout then.
+bool extractSingleResource(const std::string& filename, const std::vector<FileFormat>& formats, const ResourceQuery& query, std::optional<uint32_t> frameIndex,
+    std::string outputPath, const ExtractionOptions& options) {
+    InputSource input;
+    if (!input.open(filename) || input.size() == 0) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    IndexedResource resource;
+    uint32_t number = 0;
+    if (!findArchiveResource(filename, input, formats, query, options, resource, number)) {
+        if (query.offset) {
+            std::cerr << "No resource at position " << *query.offset << " of " << filename << std::endl;
+        }
+        else {
+            std::cerr << filename << " has no resource " << query.resourceNumber << std::endl;
+        }
+        return false;
+    }
+
+    const FormatInfo& info = formatInfoMap.at(static_cast<FileFormat>(resource.format));
+    const std::span<const std::byte> data = asBytes(input.data() + resource.offset, resource.size);
+    *options.log << "Resource " << number << ": " << info.extension << " at position " << resource.offset << ", size: " << resource.size << " bytes" << std::endl;
+
+    if (outputPath.empty()) {
+        std::string clean = cleanFolderName(filename);
+        std::replace(clean.begin(), clean.end(), '.', '_');
+        outputPath = clean + "_" + std::to_string(number) + (frameIndex ? "_frame_" + std::to_string(*frameIndex) + ".bmp" : "." + info.extension);
+    }
+
+    // Only the frame is decoded, the rest of the resource stays untouched in the mapping
+    D3GRView view;
+    if (frameIndex) {
+        if (static_cast<FileFormat>(resource.format) == FileFormat::D3GR) {
+            view = D3GRView(data);
+        }
+        if (*frameIndex >= view.frameCount()) {
+            std::cerr << "Resource " << number << " has no frame " << *frameIndex << std::endl;
+            return false;
+        }
+    }
+
+    if (outputPath == "-") {
+        std::vector<uint8_t> bmp;
+        if (frameIndex) {
+            bmp = encodeResourceFrame(view, *frameIndex, buildPaletteLUT(options.palette), options.bitmapMode, options.trimFrames);
+        }
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        std::cout.write(frameIndex ? reinterpret_cast<const char*>(bmp.data()) : reinterpret_cast<const char*>(data.data()),
+            static_cast<std::streamsize>(frameIndex ? bmp.size() : data.size()));
+        std::cout.flush();
+        return static_cast<bool>(std::cout);
+    }
+
+    bool written = frameIndex ? extractFrameToBMP(view, *frameIndex, outputPath, buildPaletteLUT(options.palette), options.bitmapMode, options.trimFrames)
+        : writeOutputFile(outputPath, data.data(), data.size());
+    if (!written) {
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        return false;
+    }
+    *options.log << "Wrote " << outputPath << std::endl;
+    return true;
+}
+
+// -- OUTPUT MANIFEST --
+// Every output folder of a mapped run has a manifest of what the last run wrote there. A resource whose
+// content, palette and output settings are unchanged and whose outputs are all still there is skipped.
+
+// Manifests of one run, per format like the session
+struct RunManifests {
+    bool enabled = false;
+    uint64_t archiveSize = 0;
+    int64_t archiveModified = 0;
+    std::vector<OutputManifest> previous;
+    std::vector<bool> sameArchive;          // Manifest was written for this very archive, resources can be matched by position
+    std::vector<uint64_t> paletteHashes;
+    std::vector<uint64_t> settingsHashes;
+};
+
+// Hash of the settings that shape the outputs of a format
+uint64_t outputSettingsHash(const FormatInfo& info, const ExtractionOptions& options) {
+    uint32_t settings[6] = { options.exportRawResources ? 1u : 0u, 0, 0, 0, 0, 0 };
+    if (info.extractContents) {
+        settings[1] = options.extractIndividualFrames ? 1u : 0u;
+        settings[2] = options.extractSpritesheet ? 1u : 0u;
+        settings[3] = static_cast<uint32_t>(options.bitmapMode);
+        settings[4] = options.atlasMaxPageSize;
+        settings[5] = options.trimFrames ? 1u : 0u;
+    }
+    return hashBytes(settings, sizeof(settings));
+}
+
+RunManifests loadRunManifests(const CarveSession& session, const std::string& filename, size_t archiveSize, uint64_t paletteHash, const ExtractionOptions& options) {
+    RunManifests manifests;
+    manifests.enabled = (options.useManifest || options.writeManifest) && options.writer->backend() != OutputWriter::Backend::Pack;
+    manifests.archiveSize = archiveSize;
+    manifests.archiveModified = fileModifiedTime(filename);
+    manifests.previous.resize(session.infos.size());
+    manifests.sameArchive.assign(session.infos.size(), false);
+
+    for (size_t i = 0; i < session.infos.size(); ++i) {
+        const FormatInfo& info = *session.infos[i];
+        manifests.paletteHashes.push_back(info.extractContents ? paletteHash : 0);
+        manifests.settingsHashes.push_back(outputSettingsHash(info, options));
+
+        OutputManifest& manifest = manifests.previous[i];
+        const std::string manifestPath = outputManifestPath(session.subfolders[i]);
+        if (!manifests.enabled || !options.useManifest || !readOutputManifest(manifestPath, manifest)) {
+            manifest = OutputManifest();
+            continue;
+        }
+        manifests.sameArchive[i] = manifest.archiveSize == archiveSize && manifest.archiveModified == manifests.archiveModified;
+        *options.log << "Using output manifest " << manifestPath << " (" << manifest.entries.size() << " resources)" << std::endl;
+    }
+    return manifests;
+}
+
+// Hashes the resource for the manifest and returns the entry of the last run when its outputs are still current
+// (never when useManifest is off, there are no previous manifests then)
+const ManifestEntry* findCurrentOutputs(const RunManifests& manifests, ResourceJob& job) {
+    const ManifestEntry* entry = findManifestEntry(manifests.previous[job.formatIndex], static_cast<uint32_t>(job.resourceIndex));
+
+    // Same archive and position is the same content, anything else is hashed
+    if (entry && manifests.sameArchive[job.formatIndex] && entry->offset == job.offset && entry->size == job.size) {
+        job.hash = entry->resourceHash;
+    }
+    else {
+        job.hash = hashBytes(job.data, job.size);
+    }
+
+    if (!entry || entry->size != job.size || entry->resourceHash != job.hash ||
+        entry->paletteHash != manifests.paletteHashes[job.formatIndex] ||
+        entry->settingsHash != manifests.settingsHashes[job.formatIndex] || !areManifestOutputsCurrent(*entry))
+        return nullptr;
+    return entry;
+}
+
+// Every file written for a resource, false when that isn't known or some of them couldn't be made
+bool listResourceOutputs(const CarveSession& session, const ResourceJob& job, const ExtractionOptions& options, std::vector<std::string>& files) {
+    const FormatInfo& info = *session.infos[job.formatIndex];
+    // Content handlers other than the frame stages don't report their files
+    if (info.extractContents && !info.indexFrames)
+        return false;
+    if (options.extractSpritesheet && info.indexFrames && !job.spritesheetCreated)
+        return false;
+
+    if (options.exportRawResources) {
+        files.push_back(resourceOutputPath(session, job.formatIndex, job.resourceIndex));
+    }
+    if (options.extractIndividualFrames && info.indexFrames) {
+        for (size_t i = 0; i < job.view.frameCount(); ++i) {
+            files.push_back(graphicsFramePath(job, static_cast<uint16_t>(i)));
+        }
+        if (options.trimFrames) {
+            files.push_back(job.framesFolder + "/frames.json");
+        }
+    }
+    files.insert(files.end(), job.spritesheetFiles.begin(), job.spritesheetFiles.end());
+    return true;
+}
+
+// Records the outputs of the run once they're all on disk, written is false when some write failed
+void saveRunManifests(const RunManifests& manifests, const CarveSession& session, const std::vector<std::unique_ptr<ResourceJob>>& jobs,
+    const ExtractionOptions& options, bool written) {
+    if (!manifests.enabled || !options.writeManifest)
+        return;
+
+    for (size_t i = 0; i < session.infos.size(); ++i) {
+        const std::string manifestPath = outputManifestPath(session.subfolders[i]);
+
+        // Outputs of the failed write can't be told from good ones by their size, nothing is trusted next time
+        if (!written) {
+            std::error_code error;
+            std::filesystem::remove(manifestPath, error);
+            continue;
+        }
+
+        OutputManifest manifest;
+        manifest.archiveSize = manifests.archiveSize;
+        manifest.archiveModified = manifests.archiveModified;
+        for (const auto& job : jobs) {
+            if (job->formatIndex != i)
+                continue;
+
+            if (job->skipped) {
+                manifest.entries.push_back(*findManifestEntry(manifests.previous[i], static_cast<uint32_t>(job->resourceIndex)));
+                continue;
+            }
+
+            std::vector<std::string> files;
+            ManifestEntry entry = { static_cast<uint32_t>(job->resourceIndex), job->offset, job->size, job->hash,
+                manifests.paletteHashes[i], manifests.settingsHashes[i], static_cast<uint32_t>(job->frameCount), {} };
+            if (listResourceOutputs(session, *job, options, files) && recordManifestOutputs(entry, files)) {
+                manifest.entries.push_back(std::move(entry));
+            }
+        }
+
+        if (!writeOutputManifest(manifestPath, manifest)) {
+            std::cerr << "Failed to write output manifest: " << manifestPath << std::endl;
+        }
+    }
+}
+
+// -- EXTRACTION PIPELINE --
+// Mapped archives go through five stages:
+//   scan    finds the resources, or reads them from the index, and numbers them in archive order
+//   parse   hands the raw copy to the writer and splits graphics resources into frames
+//   decode  finds the written region of every frame and claims its content, identical frames are only encoded once
+//   encode  turns frames and spritesheets into BMP files
+//   write   the OutputWriter (io_uring or writer threads)
+// Scan runs on the calling thread and submits a parse task to options.pool for every resource it finds,
+// which submits a decode task for every few frames and an encode task for the spritesheet. Decode passes
+// the frames that weren't linked on to an encode task. When too many tasks are waiting the scan helps with
+// them until the pool catches up, so a run never uses more threads than the pool has and batch runs share
+// it with their other archives. parseThreads, decodeThreads and encodeThreads cap the tasks of a stage
+// running at once.
+// Every resource logs into its own buffer, the buffers are printed in archive order afterwards so the
+// output reads like a serial run. The time each stage spent busy, queued for a thread and blocked is printed
+// at the end.
+
+// Frames decoded and encoded by one task, single frames are too small to be worth a task each
+const size_t kFramesPerTask = 8;
+
+bool runExtractionPipeline(CarveSession& session, InputSource& input, const std::string& filename, const std::vector<FileFormat>& formats, const ExtractionOptions& options) {
+    const char* fileData = input.data();
+    const size_t archiveSize = input.size();
+    const uint64_t paletteHash = hashBytes(session.paletteLUT.bgra, sizeof(session.paletteLUT.bgra));
+
+    const auto start = std::chrono::steady_clock::now();
+    const StageStats writerBefore = options.writer->stats();
+    const RunManifests manifests = loadRunManifests(session, filename, archiveSize, paletteHash, options);
+
+    ThreadPool& pool = *options.pool;
+    // Tasks allowed to wait before the scan stops to help, enough to keep every thread busy
+    const size_t maxPendingTasks = std::max<size_t>(16, size_t(4) * pool.threadCount());
+
+    std::vector<std::unique_ptr<ResourceJob>> jobs;     // Only touched by scan until it's done
+    TaskGroup tasks;
+
+    PipelineStage scan("scan", pool, tasks, 1);
+    PipelineStage parse("parse", pool, tasks, options.parseThreads);
+    PipelineStage decode("decode", pool, tasks, options.decodeThreads);
+    PipelineStage encode("encode", pool, tasks, options.encodeThreads);
+
+    // Frames found identical to one written before are linked by decode, the others go on to encode together
+    auto submitFrames = [&](ResourceJob& job, size_t begin, size_t end) {
+        decode.submit([&, begin, end] {
+            auto frames = std::make_shared<std::vector<std::pair<uint16_t, uint64_t>>>();
+            for (size_t i = begin; i < end; ++i) {
+                const uint16_t frame = static_cast<uint16_t>(i);
+                uint64_t key = 0;
+                if (decodeGraphicsFrame(job, frame, paletteHash, options, key)) {
+                    frames->push_back({ frame, key });
+                }
+            }
+            if (frames->empty())
+                return;
+
+            encode.submit([&, frames] {
+                for (const auto& [frame, key] : *frames) {
+                    encodeGraphicsFrame(job, frame, key, session.paletteLUT, options);
+                }
+                }, frames->size());
+            }, end - begin);
+    };
+
+    auto submitSpritesheet = [&](ResourceJob& job) {
+        encode.submit([&] { encodeGraphicsSpritesheet(job, session.paletteLUT, options); });
+    };
+
+    auto parseResource = [&](ResourceJob& job) {
+        const FormatInfo& info = *session.infos[job.formatIndex];
+        const std::string& subfolder = session.subfolders[job.formatIndex];
+
+        // Nothing to do when the last run's outputs are still current
+        const ManifestEntry* current = manifests.enabled ? findCurrentOutputs(manifests, job) : nullptr;
+        if (current) {
+            logFoundResource(info, job.offset, job.size, job.log);
+            job.log << "  Outputs from the last run are current, skipped" << std::endl;
+            job.frameCount = static_cast<int>(current->frameCount);
+            job.skipped = true;
+            return;
+        }
+
+        writeResourceCopy(session, job.formatIndex, job.resourceIndex, job.data, job.size, job.offset, options, job.log);
+
+        // Formats with a frame table go through the frame stages, any other content handler runs right here
+        if (info.indexFrames) {
+            beginGraphicsResource(job, subfolder, options);
+            job.framesBegun = true;
+            if (options.extractSpritesheet) {
+                submitSpritesheet(job);
+            }
+            if (options.extractIndividualFrames) {
+                for (size_t begin = 0; begin < job.view.frameCount(); begin += kFramesPerTask) {
+                    submitFrames(job, begin, std::min(job.view.frameCount(), begin + kFramesPerTask));
+                }
+            }
+        }
+        else if (info.extractContents) {
+            job.frameCount = info.extractContents(asBytes(job.data, job.size), subfolder, job.resourceIndex, options, session.paletteLUT, job.log);
+        }
+    };
+
+    // The scan walks the archive front to back exactly once
+    const auto scanStart = std::chrono::steady_clock::now();
+    uint64_t throttledNanos = 0;
+    input.adviseSequential();
+    loadResourceIndex(filename, fileData, archiveSize, formats, options, [&](const IndexedResource& resource) {
+        auto job = std::make_unique<ResourceJob>();
+        job->formatIndex = std::find(formats.begin(), formats.end(), static_cast<FileFormat>(resource.format)) - formats.begin();
+        job->resourceIndex = session.fileCounts[job->formatIndex]++;
+        job->data = fileData + resource.offset;
+        job->size = resource.size;
+        job->offset = resource.offset;
+
+        // Resource body hasn't been touched by the scan yet, start reading it ahead
+        input.adviseWillNeed(resource.offset, resource.size);
+
+        jobs.push_back(std::move(job));
+        ResourceJob* queued = jobs.back().get();
+        parse.submit([&, queued] { parseResource(*queued); });
+
+        // Too far ahead of the other stages, help with their tasks until half of them are done
+        if (tasks.pending.load() > maxPendingTasks) {
+            const auto throttleStart = std::chrono::steady_clock::now();
+            pool.wait(tasks, maxPendingTasks / 2);
+            throttledNanos += pipelineNanosSince(throttleStart);
+        }
+        });
+    const uint64_t scanNanos = pipelineNanosSince(scanStart);
+    scan.record(scanNanos > throttledNanos ? scanNanos - throttledNanos : 0, jobs.size());
+    scan.recordBlocked(throttledNanos);
+
+    pool.wait(tasks);
+
+    // Graphics resources are summed up once every frame of the archive has claimed its content, so which
+    // frames count as links doesn't depend on the order the resources finished in
+    for (const auto& job : jobs) {
+        if (job->framesBegun) {
+            finishGraphicsResource(*job, options);
+        }
+    }
+
+    // Raw copies are written straight from the mapping, which closes when this returns
+    const bool written = options.writer->flush();
+    saveRunManifests(manifests, session, jobs, options, written);
+    const uint64_t wallNanos = pipelineNanosSince(start);
+
+    size_t skipped = 0;
+    for (const auto& job : jobs) {
+        *options.log << job->log.str();
+        session.frameCounts[job->formatIndex] += job->frameCount;
+        skipped += job->skipped ? 1 : 0;
+    }
+    if (skipped > 0) {
+        *options.log << skipped << " resources were unchanged since the last run, their outputs were kept" << std::endl;
+    }
+    bool extracted = finishCarveSession(session, options);
+
+    StageStats write = options.writer->stats();
+    write.busyNanos -= writerBefore.busyNanos;
+    write.starvedNanos -= writerBefore.starvedNanos;
+    write.items -= writerBefore.items;
+
+    *options.log << "Pipeline stages over " << std::fixed << std::setprecision(3) << (static_cast<double>(wallNanos) / 1e9)
+        << " s:" << std::defaultfloat << std::setprecision(6) << std::endl;
+    for (const PipelineStage* stage : { &scan, &parse, &decode, &encode }) {
+        printStageStats(*options.log, stage->name(), stage->stats(), wallNanos, true);
+    }
+    printStageStats(*options.log, "write", write, wallNanos, false);
+
+    return extracted;
+}
+
+// -- MAIN EXTRACTION FUNCTION --
+bool extractFiles(const std::string& filename, const std::vector<FileFormat>& formats, const ExtractionOptions& callerOptions = ExtractionOptions()) {
+    // Use the caller's pool, or one for this run
+    ExtractionOptions options = callerOptions;
+    std::unique_ptr<ThreadPool> runPool;
+    if (!options.pool) {
+        runPool = std::make_unique<ThreadPool>(options.workerThreads);
+        options.pool = runPool.get();
+    }
+    std::unique_ptr<OutputWriter> runWriter;
+    std::unique_ptr<FrameStore> packFrameStore;
+    if (options.packOutput) {
+        std::string packPath = options.packPath;
+        if (packPath.empty()) {
+            packPath = (filename == "-" ? std::string("stdin") : cleanFolderName(filename)) + ".pack";
+        }
+        runWriter = std::make_unique<OutputWriter>(packPath, options.writeBufferLimit);
+        if (!runWriter->isOpen())
+            return false;
+        options.writer = runWriter.get();
+        *options.log << "Writing output to pack " << packPath << std::endl;
+
+        // Frames can only be linked to frames in the same pack
+        if (options.frameStore) {
+            packFrameStore = std::make_unique<FrameStore>();
+            options.frameStore = packFrameStore.get();
+        }
+    }
+    else if (!options.writer) {
+        runWriter = std::make_unique<OutputWriter>(options.writerThreads, options.writeBufferLimit);
+        options.writer = runWriter.get();
+    }
+
+    // "-" reads the archive from stdin
+    if (filename == "-") {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        return extractFilesStreaming(std::cin, "stdin", formats, options);
+    }
+
+    // Map the file (or read it in one go if it can't be mapped)
+    InputSource input;
+    if (options.streaming || !input.open(filename)) {
+        // Pipes and files too large to load still work through the window
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            std::cerr << "Failed to open file: " << filename << std::endl;
+            return false;
+        }
+        return extractFilesStreaming(file, filename, formats, options);
+    }
+
+    const size_t archiveSize = input.size();
+    if (archiveSize == 0) {
+        std::cerr << "File is empty" << std::endl;
+        return false;
+    }
+
+    *options.log << "File size: " << archiveSize << " bytes" << std::endl;
+
+    CarveSession session = beginCarveSession(filename, formats, options);
+    session.inputMapped = true;
+    session.inputFd = input.fileDescriptor();
+    return runExtractionPipeline(session, input, filename, formats, options);
+}
+
+// -- PALETTE DATA --
+// Palettes and the RES files they belong to (headers/PaletteDatabase.h). CMake copies the database next to
+// the program, one in the working directory takes precedence.
+const std::string kDefaultPaletteDatabase = "palettes.db";
+
+// Directory of the running program, empty when it can't be found
+std::filesystem::path programDirectory() {
+#if defined(_WIN32)
+    wchar_t path[MAX_PATH];
+    DWORD length = GetModuleFileNameW(nullptr, path, MAX_PATH);
+    if (length > 0 && length < MAX_PATH)
+        return std::filesystem::path(std::wstring(path, length)).parent_path();
+#elif defined(__linux__)
+    std::error_code error;
+    std::filesystem::path program = std::filesystem::read_symlink("/proc/self/exe", error);
+    if (!error)
+        return program.parent_path();
+#endif
+    return std::filesystem::path();
+}
+
+// The palette database used unless another is given: the working directory's, else the one next to the program
+std::string defaultPaletteDatabasePath() {
+    std::error_code error;
+    if (std::filesystem::exists(kDefaultPaletteDatabase, error))
+        return kDefaultPaletteDatabase;
+
+    const std::filesystem::path directory = programDirectory();
+    if (!directory.empty() && std::filesystem::exists(directory / kDefaultPaletteDatabase, error))
+        return (directory / kDefaultPaletteDatabase).string();
+    return kDefaultPaletteDatabase;
+}
+
+// Frames can't be given their colors without the database, only other formats can be carved
+bool selectsGraphics(const std::vector<FileFormat>& formats) {
+    return std::find(formats.begin(), formats.end(), FileFormat::D3GR) != formats.end();
+}
+
+// -- BATCH EXTRACTION --
+// Matches a file name against a pattern where * is any run of characters and ? any single one
+bool wildcardMatch(const std::string& pattern, const std::string& name) {
+    size_t p = 0, n = 0;
+    size_t starP = std::string::npos, starN = 0;
+    while (n < name.size()) {
+        if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+            ++p;
+            ++n;
+        }
+        else if (p < pattern.size() && pattern[p] == '*') {
+            starP = p++;
+            starN = n;
+        }
+        else if (starP != std::string::npos) {
+            // Let the last * take one more character
+            p = starP + 1;
+            n = ++starN;
+        }
+        else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == '*') {
+        ++p;
+    }
+    return p == pattern.size();
+}
+
+bool isBatchPattern(const std::string& input) {
+    std::error_code error;
+    return input.find_first_of("*?") != std::string::npos || std::filesystem::is_directory(input, error);
+}
+
+// Archives named by a directory (every file in it) or a pattern such as data/RES.0*, biggest first
+std::vector<std::string> resolveBatchInputs(const std::string& input) {
+    std::error_code error;
+    std::filesystem::path directory = input;
+    std::string namePattern = "*";
+    if (!std::filesystem::is_directory(directory, error)) {
+        directory = std::filesystem::path(input).parent_path();
+        namePattern = std::filesystem::path(input).filename().string();
+        if (directory.empty()) {
+            directory = ".";
+        }
+    }
+
+    std::vector<std::pair<uintmax_t, std::string>> archives;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        // Index sidecars live next to the archives
+        if (!entry.is_regular_file(error) || entry.path().extension() == ".toc" || !wildcardMatch(namePattern, name))
+            continue;
+        archives.push_back({ entry.file_size(error), entry.path().string() });
+    }
+
+    // Biggest first, so the run doesn't end waiting for one large archive started last
+    std::sort(archives.begin(), archives.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+        });
+
+    std::vector<std::string> paths;
+    for (const auto& archive : archives) {
+        paths.push_back(archive.second);
+    }
+    return paths;
+}
+
+// Outcome of one archive of a batch run
+struct ArchiveResult {
+    uintmax_t size = 0;
+    double seconds = 0;
+    bool success = false;
+    RunStats stats;
+};
+
+// Extracts archives concurrently, all archives and their resources sharing one thread pool. Each archive gets
+// the palette options.palettes has for its name, unless paletteByName is false. The outcome of every archive
+// goes in results when it's set, in the order of archives.
+bool extractArchives(const std::vector<std::string>& archives, const std::vector<FileFormat>& formats, const ExtractionOptions& callerOptions,
+    bool paletteByName = true, std::vector<ArchiveResult>* archiveResults = nullptr) {
+    ExtractionOptions options = callerOptions;
+    std::unique_ptr<ThreadPool> batchPool;
+    if (!options.pool) {
+        batchPool = std::make_unique<ThreadPool>(options.workerThreads);
+        options.pool = batchPool.get();
+    }
+    // One writer for every archive, frames linked to a frame of another archive wait until it's written.
+    // Each archive submits through a writer of its own made from it, to wait for and check only its files.
+    std::unique_ptr<OutputWriter> batchWriter;
+    if (!options.writer) {
+        batchWriter = std::make_unique<OutputWriter>(options.writerThreads, options.writeBufferLimit);
+        options.writer = batchWriter.get();
+    }
+
+    std::cout << "Extracting " << archives.size() << " archives on " << options.pool->threadCount() << " threads" << std::endl;
+
+    std::vector<ArchiveResult> results(archives.size());
+    std::mutex logMutex;
+
+    // Archives are numbered in the order given, identical frames are written under the path of the first one
+    const uint32_t firstArchiveRank = options.frameStore ? options.frameStore->reserveArchives(static_cast<uint32_t>(archives.size())) : 0;
+
+    const auto batchStart = std::chrono::steady_clock::now();
+    TaskGroup archiveTasks;
+    for (size_t i = 0; i < archives.size(); ++i) {
+        options.pool->submit(archiveTasks, [&, i] {
+            const auto start = std::chrono::steady_clock::now();
+
+            // Each archive logs into its own buffer, printed in one piece once it's done
+            std::ostringstream log;
+            ExtractionOptions archiveOptions = options;
+            archiveOptions.log = &log;
+            archiveOptions.archiveRank = firstArchiveRank + static_cast<uint32_t>(i);
+            OutputWriter archiveWriter(*options.writer);
+            archiveOptions.writer = &archiveWriter;
+            // Each archive gets its own <archive>.pack, packPath only names the pack of a single archive.
+            // The other archives keep the pool busy, so each one scans on its own thread.
+            if (archives.size() > 1) {
+                archiveOptions.packPath.clear();
+                if (archiveOptions.scanThreads == 0) {
+                    archiveOptions.scanThreads = 1;
+                }
+            }
+            archiveOptions.stats = &results[i].stats;
+            std::string name = std::filesystem::path(archives[i]).filename().string();
+            if (paletteByName && options.palettes) {
+                std::span<const uint8_t> palette = options.palettes->paletteFor(name);
+                if (!palette.empty()) {
+                    archiveOptions.palette = palette;
+                }
+            }
+
+            std::error_code error;
+            results[i].size = std::filesystem::file_size(archives[i], error);
+            if (error) {
+                results[i].size = 0;
+            }
+            results[i].success = extractFiles(archives[i], formats, archiveOptions);
+            results[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cout << "== " << archives[i] << " ==" << std::endl << log.str() << std::endl;
+            });
+    }
+    options.pool->wait(archiveTasks);
+    const double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+
+    // Throughput report
+    auto mibPerSecond = [](uintmax_t bytes, double seconds) {
+        return seconds > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+    };
+
+    uintmax_t totalBytes = 0;
+    int extractedArchives = 0;
+    std::cout << "Batch summary:" << std::endl;
+    for (size_t i = 0; i < archives.size(); ++i) {
+        std::cout << "  " << archives[i] << ": " << results[i].size << " bytes in " << std::fixed << std::setprecision(2)
+            << results[i].seconds << " s (" << mibPerSecond(results[i].size, results[i].seconds) << " MiB/s)"
+            << (results[i].success ? "" : ", nothing extracted") << std::defaultfloat << std::endl;
+        totalBytes += results[i].size;
+        extractedArchives += results[i].success ? 1 : 0;
+        if (options.stats) {
+            options.stats->resources += results[i].stats.resources;
+            options.stats->frames += results[i].stats.frames;
+        }
+    }
+    std::cout << "  Total: " << archives.size() << " archives, " << totalBytes << " bytes in " << std::fixed << std::setprecision(2)
+        << totalSeconds << " s (" << mibPerSecond(totalBytes, totalSeconds) << " MiB/s)" << std::defaultfloat << std::endl;
+
+    if (archiveResults) {
+        *archiveResults = std::move(results);
+    }
+    return extractedArchives > 0;
+}
+
+// Extracts every archive matched by input, all archives and their resources sharing one thread pool
+bool extractBatch(const std::string& input, const std::vector<FileFormat>& formats, const ExtractionOptions& options = ExtractionOptions()) {
+    std::vector<std::string> archives = resolveBatchInputs(input);
+    if (archives.empty()) {
+        std::cerr << "No archives found for " << input << std::endl;
+        return false;
+    }
+    return extractArchives(archives, formats, options);
+}
+
+
+// -- INTERACTIVE SESSION --
+// Prompts for an input and the options, extracts it and starts over until EXIT
+int runInteractiveSession() {
+    std::string filename = "";
+    bool extractIndividualFrames = true;  // Default to true for backward compatibility
+    bool extractSpritesheet = false;     // Default to false
+    BitmapMode bitmapMode = BitmapMode::TrueColor;
+    bool trimFrames = false;
+    FrameStore frameStore;               // Kept for the whole session so duplicates are found across archives
+    ThreadPool pool;                     // Every hardware thread
+    OutputWriter writer;                 // Background writes for every run
+    PaletteDatabase palettes;            // Mapped once, palettes are used from it in place
+    const std::string paletteDatabase = defaultPaletteDatabasePath();
+    const bool palettesLoaded = palettes.open(paletteDatabase);
+    if (!palettesLoaded) {
+        std::cerr << "Palette database " << paletteDatabase << " can't be read, only WAV files can be extracted" << std::endl;
+    }
+    // Palette of the archive entered, the database default for archives without one of their own
+    std::span<const uint8_t> palette;
+
+    while (true) {
+        std::cout << "Enter the filename, directory or pattern (e.g. RES.0*) to scan (type EXIT to close the program): ";
+        std::getline(std::cin, filename);
+
+        if (filename == "EXIT") {
+	        std::cout << "Exiting program..." << std::endl;
+	        break;
+        }
+        else {
+            palette = palettes.defaultPalette();
+            std::span<const uint8_t> archivePalette = palettes.paletteFor(std::filesystem::path(filename).filename().string());
+            if (!archivePalette.empty()) {
+                palette = archivePalette;
+                std::cout << "Palette for " << filename << " has been set.\n";
+            }
+            else {
+                std::cout << "No palette found for " << filename << ".\n";
+            }
+        }
+
+        // Display available formats to extract
+        std::cout << "\nAvailable formats to extract:" << std::endl;
+        int i = 1;
+        for (const auto& format : formatInfoMap) {
+            std::cout << i++ << ". " << format.second.name << " (." << format.second.extension << ")" << std::endl;
+        }
+        const int allFormatsChoice = i;
+        std::cout << allFormatsChoice << ". All formats (single pass)" << std::endl;
+
+        // Get user choice
+        int choice = 0;
+        std::string choiceStr;
+        while (choice < 1 || choice > allFormatsChoice) {
+            std::cout << "\nSelect format to extract (1-" << allFormatsChoice << "): ";
+            std::getline(std::cin, choiceStr);
+
+            try {
+                choice = std::stoi(choiceStr);
+            }
+            catch (...) {
+                choice = 0;
+            }
+        }
+
+        // Convert choice to the list of formats to carve
+        std::vector<FileFormat> selectedFormats;
+        if (choice == allFormatsChoice) {
+            for (const auto& format : formatInfoMap) {
+                selectedFormats.push_back(format.first);
+            }
+        }
+        else {
+            selectedFormats.push_back(static_cast<FileFormat>(choice - 1));
+        }
+
+        if (selectsGraphics(selectedFormats) && !palettesLoaded) {
+            std::cerr << "D3GR frames need the palette database " << paletteDatabase << ", which can't be read" << std::endl;
+            continue;
+        }
+
+        // If D3GR format was selected, ask for extraction options
+        if (selectsGraphics(selectedFormats)) {
+            std::cout << "\nD3GR extraction options:" << std::endl;
+            std::cout << "1. Extract individual frames" << std::endl;
+            std::cout << "2. Extract spritesheet" << std::endl;
+            std::cout << "3. Extract both" << std::endl;
+
+            int extractOption = 0;
+            while (extractOption < 1 || extractOption > 3) {
+                std::cout << "Select option (1-3): ";
+                std::getline(std::cin, choiceStr);
+
+                try {
+                    extractOption = std::stoi(choiceStr);
+                }
+                catch (...) {
+                    extractOption = 0;
+                }
+            }
+
+            // Set extraction flags based on user choice
+            switch (extractOption) {
+            case 1:
+                extractIndividualFrames = true;
+                extractSpritesheet = false;
+                break;
+            case 2:
+                extractIndividualFrames = false;
+                extractSpritesheet = true;
+                break;
+            case 3:
+                extractIndividualFrames = true;
+                extractSpritesheet = true;
+                break;
+            }
+
+            std::cout << "\nBitmap output:" << std::endl;
+            std::cout << "1. 24-bit color" << std::endl;
+            std::cout << "2. 8-bit indexed (smaller, palette embedded)" << std::endl;
+
+            int bitmapOption = 0;
+            while (bitmapOption < 1 || bitmapOption > 2) {
+                std::cout << "Select option (1-2): ";
+                std::getline(std::cin, choiceStr);
+
+                try {
+                    bitmapOption = std::stoi(choiceStr);
+                }
+                catch (...) {
+                    bitmapOption = 0;
+                }
+            }
+
+            bitmapMode = bitmapOption == 2 ? BitmapMode::Indexed : BitmapMode::TrueColor;
+
+            std::string trimAnswer;
+            while (trimAnswer != "y" && trimAnswer != "n") {
+                std::cout << "Trim transparent borders of frames? (y/n): ";
+                std::getline(std::cin, trimAnswer);
+            }
+            trimFrames = trimAnswer == "y";
+        }
+
+        // Extract files of the chosen format
+        ExtractionOptions options;
+        options.extractIndividualFrames = extractIndividualFrames;
+        options.extractSpritesheet = extractSpritesheet;
+        options.bitmapMode = bitmapMode;
+        options.trimFrames = trimFrames;
+        options.frameStore = &frameStore;
+        options.pool = &pool;
+        options.writer = &writer;
+        options.palette = palette;
+        options.palettes = &palettes;
+
+        // A directory or a pattern such as RES.0* extracts every archive it matches
+        bool batch = isBatchPattern(filename);
+        if (!batch) {
+            options.archiveRank = frameStore.reserveArchives(1);
+        }
+        bool success = batch ? extractBatch(filename, selectedFormats, options)
+            : extractFiles(filename, selectedFormats, options);
+
+        if (success) {
+            std::cout << "Extraction completed successfully!" << std::endl;
+        }
+        else {
+            std::cout << "No files were extracted." << std::endl;
+        }
+
+        // Add a visual separator between extraction sessions
+        std::cout << "\n----------------------------------------\n" << std::endl;
+    }
+    return 0;
+}
+
+// -- COMMAND LINE --
+// Arguments for runs without the prompts, e.g. FileUnpacker -f d3gr --spritesheet -o out --json data/RES.0*
+struct CommandLine {
+    std::vector<std::string> inputs;
+    std::vector<FileFormat> formats;
+    ExtractionOptions options;
+    std::string palette = "auto";
+    std::string paletteDatabase = defaultPaletteDatabasePath();
+    std::vector<std::string> paletteAdditions;  // NAME=FILE, the database is updated instead of extracting
+    std::string outputRoot;
+    unsigned shardIndex = 0;
+    unsigned shardCount = 1;
+    bool lookup = false;            // Only one resource (or frame) of a single archive
+    ResourceQuery query;
+    std::optional<uint32_t> frameIndex;
+    std::string lookupOutput;
+    bool list = false;
+    bool quiet = false;
+    bool json = false;
+    bool help = false;
+};
+
+void printUsage(std::ostream& out) {
+    out << "Usage: FileUnpacker [options] <input>...\n"
+        "       FileUnpacker [--palette-db FILE] --add-palette NAME=FILE...\n"
+        "       FileUnpacker              (no arguments: interactive prompts)\n"
+        "\n"
+        "Inputs are RES files, directories, patterns such as data/RES.0* or - for stdin.\n"
+        "\n"
+        "Extraction:\n"
+        "  -f, --formats LIST       Formats to carve: wav, d3gr or all (default), comma separated\n"
+        "  -m, --mode MODE          D3GR output: frames (default), spritesheet or both\n"
+        "      --indexed            8-bit indexed bitmaps instead of 24-bit color\n"
+        "      --trim               Leave out the transparent borders of frames\n"
+        "      --page-size N        Largest spritesheet page in pixels (default 8192)\n"
+        "      --no-raw             Don't write the raw copy of every resource\n"
+        "  -p, --palette PALETTE    auto (by archive name, default), an archive name such as RES.006,\n"
+        "                           or a file of 256 RGB (768 bytes) or RGBX (1024 bytes) entries\n"
+        "      --palette-db FILE    Palette database (default: palettes.db in the working directory,\n"
+        "                           else the one next to the program)\n"
+        "      --add-palette NAME=FILE\n"
+        "                           Map archive NAME to the palette in FILE in the palette database, then exit\n"
+        "\n"
+        "Output:\n"
+        "  -o, --output DIR         Output root, created if needed (default: working directory)\n"
+        "      --pack               Write one pack file per archive instead of loose files\n"
+        "      --pack-path FILE     Pack file of a single input\n"
+        "      --no-index           Don't read or write the .toc index next to the archives\n"
+        "      --no-manifest        Don't skip unchanged resources or record the outputs\n"
+        "\n"
+        "Performance:\n"
+        "  -j, --threads N          Worker threads, 0 uses every hardware thread (default)\n"
+        "      --scan-threads N     Threads scanning a mapped archive\n"
+        "      --parse-threads N    Tasks a stage of a mapped archive runs at once, 0 for no limit\n"
+        "      --decode-threads N   (defaults: parse 1, decode and encode no limit)\n"
+        "      --encode-threads N\n"
+        "      --writer-threads N   Threads writing files when io_uring isn't available\n"
+        "      --streaming          Read archives through a bounded window instead of mapping them\n"
+        "      --shard K/N          Only take every Nth archive starting with the Kth (0-based), to split\n"
+        "                           one set of inputs across machines\n"
+        "\n"
+        "Single resource:\n"
+        "      --resource N         Only extract resource N of the input, as numbered by --list\n"
+        "      --at OFFSET          Only extract the resource holding position OFFSET of the input\n"
+        "      --frame F            Only extract frame F of that D3GR resource, as a BMP\n"
+        "      --to FILE            Where it goes, - for stdout (default: named after the archive in the output root)\n"
+        "\n"
+        "Reporting:\n"
+        "      --list               List the resources of every input instead of extracting them\n"
+        "  -q, --quiet              Only print errors\n"
+        "      --json               Print a JSON report of the run on stdout, and nothing else\n"
+        "  -h, --help               Show this help\n";
+}
+
+template <typename T>
+bool parseCount(const std::string& text, T& value) {
+    const char* end = text.data() + text.size();
+    auto result = std::from_chars(text.data(), end, value);
+    return result.ec == std::errc() && result.ptr == end;
+}
+
+bool parseFormats(const std::string& list, std::vector<FileFormat>& formats) {
+    formats.clear();
+    std::stringstream names(list);
+    std::string name;
+    while (std::getline(names, name, ',')) {
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (name == "all") {
+            formats.clear();
+            for (const auto& format : formatInfoMap) {
+                formats.push_back(format.first);
+            }
+            return true;
+        }
+
+        auto format = std::find_if(formatInfoMap.begin(), formatInfoMap.end(), [&](const auto& entry) { return entry.second.extension == name; });
+        if (format == formatInfoMap.end())
+            return false;
+        if (std::find(formats.begin(), formats.end(), format->first) == formats.end()) {
+            formats.push_back(format->first);
+        }
+    }
+    return !formats.empty();
+}
+
+// Reads a palette file of 256 RGB or RGBX entries
+bool readPaletteFile(const std::string& path, std::vector<uint8_t>& palette) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() != 256 * 3 && data.size() != 256 * 4)
+        return false;
+
+    size_t stride = data.size() / 256;
+    palette.resize(kPaletteSize);
+    for (size_t i = 0; i < 256; ++i) {
+        std::copy_n(&data[i * stride], 3, &palette[i * 3]);
+    }
+    return true;
+}
+
+// Palette of an archive name in the database, or read from a palette file into storage
+bool resolvePalette(const std::string& name, const PaletteDatabase& palettes, std::vector<uint8_t>& storage, std::span<const uint8_t>& palette) {
+    palette = palettes.paletteFor(name);
+    if (!palette.empty())
+        return true;
+
+    if (!readPaletteFile(name, storage))
+        return false;
+    palette = storage;
+    return true;
+}
+
+// Maps archives to palettes in the database at path, creating it if there's none. Each addition is NAME=FILE.
+bool updatePaletteDatabase(const std::string& path, const std::vector<std::string>& additions) {
+    std::vector<std::vector<uint8_t>> palettes;
+    std::vector<PaletteMapping> mappings;
+    uint32_t defaultIndex = 0;
+    {
+        PaletteDatabase existing;
+        if (existing.open(path)) {
+            for (size_t i = 0; i < existing.paletteCount(); ++i) {
+                std::span<const uint8_t> palette = existing.palette(i);
+                palettes.emplace_back(palette.begin(), palette.end());
+            }
+            for (size_t i = 0; i < existing.mappingCount(); ++i) {
+                mappings.push_back(existing.mapping(i));
+            }
+            defaultIndex = existing.defaultPaletteIndex();
+        }
+    }
+
+    for (const std::string& addition : additions) {
+        size_t equals = addition.find('=');
+        std::string name = addition.substr(0, equals);
+        if (equals == std::string::npos || name.empty() || name.size() > 16) {
+            std::cerr << "Expected NAME=FILE with a name of up to 16 characters: " << addition << std::endl;
+            return false;
+        }
+
+        std::vector<uint8_t> palette;
+        std::string file = addition.substr(equals + 1);
+        if (!readPaletteFile(file, palette)) {
+            std::cerr << file << " isn't a palette file of 256 RGB or RGBX entries" << std::endl;
+            return false;
+        }
+
+        // Archives of the same world share one copy of its palette
+        auto same = std::find(palettes.begin(), palettes.end(), palette);
+        uint32_t index = static_cast<uint32_t>(same - palettes.begin());
+        if (same == palettes.end()) {
+            palettes.push_back(std::move(palette));
+        }
+
+        auto mapped = std::find_if(mappings.begin(), mappings.end(), [&](const PaletteMapping& mapping) { return mapping.archiveName == name; });
+        if (mapped != mappings.end()) {
+            mapped->paletteIndex = index;
+        }
+        else {
+            mappings.push_back({ name, index });
+        }
+    }
+
+    if (!writePaletteDatabase(path, palettes, mappings, defaultIndex)) {
+        std::cerr << "Failed to write palette database: " << path << std::endl;
+        return false;
+    }
+    std::cout << "Palette database " << path << " maps " << mappings.size() << " archives to " << palettes.size() << " palettes" << std::endl;
+    return true;
+}
+
+bool parseCommandLine(int argc, char* argv[], CommandLine& commandLine) {
+    ExtractionOptions& options = commandLine.options;
+    for (const auto& format : formatInfoMap) {
+        commandLine.formats.push_back(format.first);
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+
+        // --name=value is the same as --name value
+        std::string value;
+        bool inlineValue = false;
+        bool valueTaken = false;
+        size_t equals = arg.find('=');
+        if (arg.rfind("--", 0) == 0 && equals != std::string::npos) {
+            value = arg.substr(equals + 1);
+            arg.resize(equals);
+            inlineValue = true;
+        }
+        auto takeValue = [&]() {
+            if (!inlineValue) {
+                if (i + 1 >= argc) {
+                    std::cerr << arg << " needs a value" << std::endl;
+                    return false;
+                }
+                value = argv[++i];
+            }
+            valueTaken = true;
+            return true;
+        };
+        auto takeCount = [&](auto& count) {
+            if (!takeValue())
+                return false;
+            if (!parseCount(value, count)) {
+                std::cerr << "Invalid number for " << arg << ": " << value << std::endl;
+                return false;
+            }
+            return true;
+        };
+
+        bool ok = true;
+        if (arg == "-h" || arg == "--help") {
+            commandLine.help = true;
+        }
+        else if (arg == "-f" || arg == "--formats") {
+            ok = takeValue();
+            if (ok && !parseFormats(value, commandLine.formats)) {
+                std::cerr << "Unknown format in " << value << std::endl;
+                ok = false;
+            }
+        }
+        else if (arg == "-m" || arg == "--mode") {
+            ok = takeValue();
+            if (ok && value == "frames") {
+                options.extractIndividualFrames = true;
+                options.extractSpritesheet = false;
+            }
+            else if (ok && value == "spritesheet") {
+                options.extractIndividualFrames = false;
+                options.extractSpritesheet = true;
+            }
+            else if (ok && value == "both") {
+                options.extractIndividualFrames = true;
+                options.extractSpritesheet = true;
+            }
+            else if (ok) {
+                std::cerr << "Unknown mode " << value << std::endl;
+                ok = false;
+            }
+        }
+        else if (arg == "--indexed") {
+            options.bitmapMode = BitmapMode::Indexed;
+        }
+        else if (arg == "--trim") {
+            options.trimFrames = true;
+        }
+        else if (arg == "--page-size") {
+            ok = takeCount(options.atlasMaxPageSize);
+            if (ok && options.atlasMaxPageSize == 0) {
+                std::cerr << "--page-size must be at least 1" << std::endl;
+                ok = false;
+            }
+        }
+        else if (arg == "--no-raw") {
+            options.exportRawResources = false;
+        }
+        else if (arg == "-p" || arg == "--palette") {
+            ok = takeValue();
+            commandLine.palette = value;
+        }
+        else if (arg == "--palette-db") {
+            ok = takeValue();
+            commandLine.paletteDatabase = value;
+        }
+        else if (arg == "--add-palette") {
+            ok = takeValue();
+            commandLine.paletteAdditions.push_back(value);
+        }
+        else if (arg == "-o" || arg == "--output") {
+            ok = takeValue();
+            commandLine.outputRoot = value;
+        }
+        else if (arg == "--pack") {
+            options.packOutput = true;
+        }
+        else if (arg == "--pack-path") {
+            ok = takeValue();
+            options.packOutput = true;
+            options.packPath = value;
+        }
+        else if (arg == "--no-index") {
+            options.useIndex = false;
+            options.writeIndex = false;
+        }
+        else if (arg == "--no-manifest") {
+            options.useManifest = false;
+            options.writeManifest = false;
+        }
+        else if (arg == "-j" || arg == "--threads") {
+            ok = takeCount(options.workerThreads);
+        }
+        else if (arg == "--scan-threads") {
+            ok = takeCount(options.scanThreads);
+        }
+        else if (arg == "--parse-threads") {
+            ok = takeCount(options.parseThreads);
+        }
+        else if (arg == "--decode-threads") {
+            ok = takeCount(options.decodeThreads);
+        }
+        else if (arg == "--encode-threads") {
+            ok = takeCount(options.encodeThreads);
+        }
+        else if (arg == "--writer-threads") {
+            ok = takeCount(options.writerThreads);
+        }
+        else if (arg == "--streaming") {
+            options.streaming = true;
+        }
+        else if (arg == "--shard") {
+            ok = takeValue();
+            size_t slash = value.find('/');
+            if (ok && (slash == std::string::npos || !parseCount(value.substr(0, slash), commandLine.shardIndex)
+                || !parseCount(value.substr(slash + 1), commandLine.shardCount) || commandLine.shardIndex >= commandLine.shardCount)) {
+                std::cerr << "Invalid shard " << value << ", expected K/N with K < N" << std::endl;
+                ok = false;
+            }
+        }
+        else if (arg == "--resource") {
+            ok = takeCount(commandLine.query.resourceNumber);
+            commandLine.lookup = true;
+        }
+        else if (arg == "--at") {
+            uint64_t offset = 0;
+            ok = takeCount(offset);
+            commandLine.query.offset = offset;
+            commandLine.lookup = true;
+        }
+        else if (arg == "--frame") {
+            uint32_t frame = 0;
+            ok = takeCount(frame);
+            commandLine.frameIndex = frame;
+            commandLine.lookup = true;
+        }
+        else if (arg == "--to") {
+            ok = takeValue();
+            commandLine.lookupOutput = value;
+            commandLine.lookup = true;
+        }
+        else if (arg == "--list") {
+            commandLine.list = true;
+        }
+        else if (arg == "-q" || arg == "--quiet") {
+            commandLine.quiet = true;
+        }
+        else if (arg == "--json") {
+            commandLine.json = true;
+        }
+        else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option " << arg << std::endl;
+            ok = false;
+        }
+        else {
+            commandLine.inputs.push_back(arg);
+        }
+
+        if (ok && inlineValue && !valueTaken) {
+            std::cerr << arg << " doesn't take a value" << std::endl;
+            ok = false;
+        }
+        if (!ok)
+            return false;
+    }
+
+    if (!commandLine.help && commandLine.paletteAdditions.empty() && commandLine.inputs.empty()) {
+        std::cerr << "No inputs given" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Swallows everything written to it, stands in for std::cout's buffer in quiet and JSON runs
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char* /*data*/, std::streamsize count) override { return count; }
+};
+
+std::string jsonString(const std::string& text) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (c < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+void printJsonReport(const std::vector<std::string>& archives, const std::vector<ArchiveResult>& results, const RunStats& stats, double seconds, bool success) {
+    uintmax_t totalBytes = 0;
+    for (const ArchiveResult& result : results) {
+        totalBytes += result.size;
+    }
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "{\n  \"success\": " << (success ? "true" : "false") << ",\n  \"archives\": " << archives.size()
+        << ",\n  \"bytes\": " << totalBytes << ",\n  \"resources\": " << stats.resources << ",\n  \"frames\": " << stats.frames
+        << ",\n  \"seconds\": " << seconds << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        std::cout << (i > 0 ? "," : "") << "\n    {\"input\": " << jsonString(archives[i]) << ", \"success\": " << (results[i].success ? "true" : "false")
+            << ", \"bytes\": " << results[i].size << ", \"resources\": " << results[i].stats.resources << ", \"frames\": " << results[i].stats.frames
+            << ", \"seconds\": " << results[i].seconds << "}";
+    }
+    std::cout << (results.empty() ? "" : "\n  ") << "]\n}" << std::defaultfloat << std::endl;
+}
+
+// One run from the arguments. Exits with 0 when every archive had something extracted, 1 otherwise, 2 for bad arguments.
+int runCommandLine(int argc, char* argv[]) {
+    CommandLine commandLine;
+    if (!parseCommandLine(argc, argv, commandLine)) {
+        std::cerr << "Try FileUnpacker --help" << std::endl;
+        return 2;
+    }
+    if (commandLine.help) {
+        printUsage(std::cout);
+        return 0;
+    }
+
+    if (!commandLine.paletteAdditions.empty()) {
+        return updatePaletteDatabase(commandLine.paletteDatabase, commandLine.paletteAdditions) ? 0 : 1;
+    }
+
+    // The palette given, or the one of each archive's name with the database default for the others like the prompts
+    ExtractionOptions& options = commandLine.options;
+    const bool paletteByName = commandLine.palette == "auto";
+    PaletteDatabase palettes;
+    if (!palettes.open(commandLine.paletteDatabase) && paletteByName && selectsGraphics(commandLine.formats) && !commandLine.list) {
+        std::cerr << "Palette database " << commandLine.paletteDatabase << " can't be read, D3GR frames need it" << std::endl;
+        std::cerr << "Pass --palette-db FILE or --palette with a palette file, or -f wav to leave them out" << std::endl;
+        return 1;
+    }
+    std::vector<uint8_t> paletteFile;
+    options.palettes = &palettes;
+    options.palette = palettes.defaultPalette();
+    if (!paletteByName && !resolvePalette(commandLine.palette, palettes, paletteFile, options.palette)) {
+        std::cerr << "Palette " << commandLine.palette << " is neither an archive in " << commandLine.paletteDatabase << " nor a palette file" << std::endl;
+        return 2;
+    }
+
+    // Every archive the inputs name, directories and patterns expanded biggest first. An archive named
+    // twice is only extracted once, two runs at the same time would write the same files.
+    std::vector<std::string> archives;
+    std::set<std::filesystem::path> named;
+    for (const std::string& input : commandLine.inputs) {
+        std::vector<std::string> matched = isBatchPattern(input) ? resolveBatchInputs(input) : std::vector<std::string>{ input };
+        if (matched.empty()) {
+            std::cerr << "No archives found for " << input << std::endl;
+        }
+        for (const std::string& archive : matched) {
+            if (archive == "-" || named.insert(std::filesystem::absolute(archive).lexically_normal()).second) {
+                archives.push_back(archive);
+            }
+        }
+    }
+    if (archives.empty())
+        return 1;
+
+    // Every machine running the same inputs with its own shard gets a different part of them
+    if (commandLine.shardCount > 1) {
+        std::vector<std::string> shard;
+        for (size_t i = commandLine.shardIndex; i < archives.size(); i += commandLine.shardCount) {
+            shard.push_back(archives[i]);
+        }
+        archives = std::move(shard);
+    }
+
+    if (commandLine.lookup && archives.size() != 1) {
+        std::cerr << "A single resource is looked up in a single archive, " << archives.size() << " were given" << std::endl;
+        return 2;
+    }
+    if (!options.packPath.empty() && archives.size() > 1) {
+        std::cerr << "--pack-path names the pack of a single archive, " << archives.size() << " were given" << std::endl;
+        return 2;
+    }
+
+    // Inputs are opened after moving to the output root, so paths relative to where the program started are made absolute
+    if (!commandLine.outputRoot.empty()) {
+        for (std::string& archive : archives) {
+            if (archive != "-") {
+                archive = std::filesystem::absolute(archive).string();
+            }
+        }
+        if (!options.packPath.empty()) {
+            options.packPath = std::filesystem::absolute(options.packPath).string();
+        }
+        if (!commandLine.lookupOutput.empty() && commandLine.lookupOutput != "-") {
+            commandLine.lookupOutput = std::filesystem::absolute(commandLine.lookupOutput).string();
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(commandLine.outputRoot, error);
+        if (!error) {
+            std::filesystem::current_path(commandLine.outputRoot, error);
+        }
+        if (error) {
+            std::cerr << "Can't use " << commandLine.outputRoot << " as the output root: " << error.message() << std::endl;
+            return 1;
+        }
+    }
+
+    if (commandLine.lookup) {
+        std::span<const uint8_t> palette = palettes.paletteFor(std::filesystem::path(archives[0]).filename().string());
+        if (paletteByName && !palette.empty()) {
+            options.palette = palette;
+        }
+
+        // Nothing but the file goes to stdout when it's written there
+        NullBuffer nullBuffer;
+        std::ostream nullLog(&nullBuffer);
+        if (commandLine.quiet || commandLine.lookupOutput == "-") {
+            options.log = &nullLog;
+        }
+        return extractSingleResource(archives[0], commandLine.formats, commandLine.query, commandLine.frameIndex, commandLine.lookupOutput, options) ? 0 : 1;
+    }
+
+    if (commandLine.list) {
+        bool listed = true;
+        for (const std::string& archive : archives) {
+            std::cout << "== " << archive << " ==" << std::endl;
+            listed = listArchiveResources(archive, commandLine.formats, options) && listed;
+        }
+        return listed ? 0 : 1;
+    }
+
+    FrameStore frameStore;  // Duplicates are found across all the archives of the run
+    options.frameStore = &frameStore;
+    RunStats stats;
+    options.stats = &stats;
+
+    NullBuffer nullBuffer;
+    std::streambuf* consoleBuffer = nullptr;
+    if (commandLine.quiet || commandLine.json) {
+        consoleBuffer = std::cout.rdbuf(&nullBuffer);
+    }
+
+    std::vector<ArchiveResult> results;
+    const auto start = std::chrono::steady_clock::now();
+    extractArchives(archives, commandLine.formats, options, paletteByName, &results);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (consoleBuffer) {
+        std::cout.rdbuf(consoleBuffer);
+    }
+
+    bool success = std::all_of(results.begin(), results.end(), [](const ArchiveResult& result) { return result.success; });
+    if (commandLine.json) {
+        printJsonReport(archives, results, stats, seconds, success);
+    }
+    return success ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Arguments make one run without prompts, for scripts and batch jobs
+    if (argc > 1) {
+        return runCommandLine(argc, argv);
+    }
+    return runInteractiveSession();
+}
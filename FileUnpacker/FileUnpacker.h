@@ -14,3 +14,13 @@
 #include <limits>
 #include <map>
 #include <cmath>
+#include <algorithm>
+#include <thread>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
@@ -0,0 +1,128 @@
+// FrameStore.cpp : Finds frames that were already written and links them instead of writing them again.
+//
+
+#include "headers/FrameStore.h"
+
+#include <filesystem>
+#include <system_error>
+
+uint64_t FrameStore::rank(uint32_t archive, uint32_t resource, uint16_t frame) {
+    return (static_cast<uint64_t>(archive & 0xFFFF) << 48) | (static_cast<uint64_t>(resource) << 16) | frame;
+}
+
+uint32_t FrameStore::reserveArchives(uint32_t count) {
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t first = archiveCount;
+    archiveCount += count;
+    return first;
+}
+
+void FrameStore::forget(const std::string& path, uint64_t key) {
+    auto previous = contents.find(path);
+    if (previous == contents.end() || previous->second == key)
+        return;
+
+    auto group = files.find(previous->second);
+    if (group != files.end() && group->second.published && (group->second.path == path || group->second.written == path)) {
+        files.erase(group);
+    }
+}
+
+FrameStore::Claim FrameStore::claim(uint64_t key, uint64_t rank, const std::string& path, std::string& target) {
+    std::lock_guard<std::mutex> lock(mutex);
+    forget(path, key);
+    contents[path] = key;
+
+    auto [it, inserted] = files.try_emplace(key);
+    Group& group = it->second;
+    if (inserted) {
+        group.rank = rank;
+        group.path = path;
+        group.members.push_back(path);
+        return Claim::Write;
+    }
+
+    if (rank < group.rank) {
+        group.rank = rank;
+        group.path = path;
+    }
+    if (group.published) {
+        target = group.written;
+        return Claim::Link;
+    }
+
+    group.members.push_back(path);
+    return Claim::Joined;
+}
+
+std::string FrameStore::beginPublish(uint64_t key, const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(key);
+    if (it == files.end())
+        return path;
+
+    // Frames joining from here on are still linked by finishPublish
+    it->second.written = it->second.path;
+    return it->second.written;
+}
+
+std::vector<std::string> FrameStore::finishPublish(uint64_t key, const std::string& written, bool success) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(key);
+    if (it == files.end())
+        return {};
+
+    std::vector<std::string> waiting;
+    for (std::string& member : it->second.members) {
+        if (member != written) {
+            waiting.push_back(std::move(member));
+        }
+    }
+    it->second.members.clear();
+
+    // A content that couldn't be written starts over with the next frame that has it
+    if (success) {
+        it->second.published = true;
+    }
+    else {
+        files.erase(it);
+    }
+    return waiting;
+}
+
+bool FrameStore::isCanonical(uint64_t key, uint64_t rank) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = files.find(key);
+    return it == files.end() || it->second.rank == rank;
+}
+
+void FrameStore::countDuplicate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++duplicateCount;
+}
+
+size_t FrameStore::duplicates() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return duplicateCount;
+}
+
+bool linkOutputFile(const std::string& existing, const std::string& path) {
+    std::error_code error;
+    if (std::filesystem::equivalent(existing, path, error))
+        return true;
+
+    detachOutputFile(path);
+    std::filesystem::create_hard_link(existing, path, error);
+    if (!error)
+        return true;
+
+    // Filesystems without hard links (FAT, some network shares) still save the conversion
+    error.clear();
+    std::filesystem::copy_file(existing, path, std::filesystem::copy_options::overwrite_existing, error);
+    return !error;
+}
+
+void detachOutputFile(const std::string& path) {
+    std::error_code error;
+    std::filesystem::remove(path, error);
+}
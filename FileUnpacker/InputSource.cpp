@@ -0,0 +1,154 @@
+// InputSource.cpp : Memory-mapped access to RES files with a buffered fallback.
+//
+
+#include "headers/InputSource.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+InputSource::~InputSource() {
+    close();
+}
+
+bool InputSource::open(const std::string& filename) {
+    close();
+    if (openMapped(filename))
+        return true;
+    return openBuffered(filename);
+}
+
+void InputSource::close() {
+    if (mapped) {
+#if defined(_WIN32)
+        UnmapViewOfFile(fileData);
+        CloseHandle(static_cast<HANDLE>(mappingHandle));
+        CloseHandle(static_cast<HANDLE>(fileHandle));
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        munmap(const_cast<char*>(fileData), fileSize);
+        ::close(fd);
+#endif
+    }
+
+    buffer.clear();
+    buffer.shrink_to_fit();
+    fileData = nullptr;
+    fileSize = 0;
+    fd = -1;
+    mapped = false;
+}
+
+bool InputSource::openMapped(const std::string& filename) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    // Empty files can't be mapped, let the buffered path handle them
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    fileData = static_cast<const char*>(view);
+    fileSize = static_cast<size_t>(size.QuadPart);
+    mapped = true;
+    return true;
+#else
+    int file = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    // Only regular, non-empty files can be mapped
+    if (fstat(file, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        ::close(file);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    if (view == MAP_FAILED) {
+        ::close(file);
+        return false;
+    }
+
+    // The descriptor stays open so resources can be copied out of the file without going through memory
+    fd = file;
+    fileData = static_cast<const char*>(view);
+    fileSize = static_cast<size_t>(info.st_size);
+    mapped = true;
+    return true;
+#endif
+}
+
+bool InputSource::openBuffered(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    std::streamoff size = file.tellg();
+    if (size < 0)
+        return false;
+
+    // One bulk read instead of going through the stream buffer byte by byte
+    buffer.resize(static_cast<size_t>(size));
+    file.seekg(0, std::ios::beg);
+    if (size > 0 && !file.read(buffer.data(), size))
+        return false;
+
+    fileData = buffer.data();
+    fileSize = buffer.size();
+    return true;
+}
+
+void InputSource::adviseSequential() const {
+#if !defined(_WIN32)
+    if (mapped)
+        madvise(const_cast<char*>(fileData), fileSize, MADV_SEQUENTIAL);
+#endif
+}
+
+void InputSource::adviseWillNeed(size_t offset, size_t length) const {
+#if !defined(_WIN32)
+    if (!mapped || offset >= fileSize)
+        return;
+
+    // madvise wants a page aligned start
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t alignedOffset = offset & ~(pageSize - 1);
+    size_t end = std::min(fileSize, offset + length);
+    madvise(const_cast<char*>(fileData) + alignedOffset, end - alignedOffset, MADV_WILLNEED);
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
@@ -0,0 +1,165 @@
+// OutputManifest.cpp : Reads and writes the record of extracted outputs used to skip unchanged resources.
+//
+
+#include "headers/OutputManifest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+// Layout, all fields little endian:
+//   header   "SMAN", u32 version, u64 archive size, i64 modified, u32 entry count
+//   entries  u32 resource index, u64 offset, u32 size, u64 resource hash, u64 palette hash,
+//            u64 settings hash, u32 frame count, u32 output count
+//   outputs  u64 size, u16 path length, path
+static const char kManifestMagic[4] = { 'S', 'M', 'A', 'N' };
+static const uint32_t kManifestVersion = 1;
+
+static const size_t kHeaderSize = 28;
+static const size_t kEntrySize = 48;
+static const size_t kOutputHeaderSize = 10;
+
+static void putLE(std::vector<char>& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint64_t getLE(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+std::string outputManifestPath(const std::string& outputFolder) {
+    return outputFolder + "/.manifest";
+}
+
+bool writeOutputManifest(const std::string& manifestPath, const OutputManifest& manifest) {
+    std::vector<char> out;
+    out.insert(out.end(), kManifestMagic, kManifestMagic + 4);
+    putLE(out, kManifestVersion, 4);
+    putLE(out, manifest.archiveSize, 8);
+    putLE(out, static_cast<uint64_t>(manifest.archiveModified), 8);
+    putLE(out, manifest.entries.size(), 4);
+
+    for (const ManifestEntry& entry : manifest.entries) {
+        putLE(out, entry.resourceIndex, 4);
+        putLE(out, entry.offset, 8);
+        putLE(out, entry.size, 4);
+        putLE(out, entry.resourceHash, 8);
+        putLE(out, entry.paletteHash, 8);
+        putLE(out, entry.settingsHash, 8);
+        putLE(out, entry.frameCount, 4);
+        putLE(out, entry.outputs.size(), 4);
+
+        for (const ManifestOutput& output : entry.outputs) {
+            if (output.path.size() > UINT16_MAX)
+                return false;
+            putLE(out, output.size, 8);
+            putLE(out, output.path.size(), 2);
+            out.insert(out.end(), output.path.begin(), output.path.end());
+        }
+    }
+
+    std::ofstream file(manifestPath, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write(out.data(), out.size());
+    return static_cast<bool>(file);
+}
+
+bool readOutputManifest(const std::string& manifestPath, OutputManifest& manifest) {
+    std::ifstream file(manifestPath, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    std::streamoff fileSize = file.tellg();
+    if (fileSize < static_cast<std::streamoff>(kHeaderSize))
+        return false;
+
+    std::vector<char> data(static_cast<size_t>(fileSize));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(data.data(), fileSize))
+        return false;
+
+    if (std::memcmp(data.data(), kManifestMagic, 4) != 0 || getLE(&data[4], 4) != kManifestVersion)
+        return false;
+
+    manifest.archiveSize = getLE(&data[8], 8);
+    manifest.archiveModified = static_cast<int64_t>(getLE(&data[16], 8));
+    size_t entryCount = static_cast<size_t>(getLE(&data[24], 4));
+
+    // Every read is checked against the end, a damaged manifest is just ignored
+    const char* end = data.data() + data.size();
+    const char* cursor = data.data() + kHeaderSize;
+    manifest.entries.clear();
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (static_cast<size_t>(end - cursor) < kEntrySize)
+            return false;
+
+        ManifestEntry entry;
+        entry.resourceIndex = static_cast<uint32_t>(getLE(cursor, 4));
+        entry.offset = getLE(cursor + 4, 8);
+        entry.size = static_cast<uint32_t>(getLE(cursor + 12, 4));
+        entry.resourceHash = getLE(cursor + 16, 8);
+        entry.paletteHash = getLE(cursor + 24, 8);
+        entry.settingsHash = getLE(cursor + 32, 8);
+        entry.frameCount = static_cast<uint32_t>(getLE(cursor + 40, 4));
+        size_t outputCount = static_cast<size_t>(getLE(cursor + 44, 4));
+        cursor += kEntrySize;
+
+        for (size_t o = 0; o < outputCount; ++o) {
+            if (static_cast<size_t>(end - cursor) < kOutputHeaderSize)
+                return false;
+            uint64_t size = getLE(cursor, 8);
+            size_t pathLength = static_cast<size_t>(getLE(cursor + 8, 2));
+            cursor += kOutputHeaderSize;
+            if (static_cast<size_t>(end - cursor) < pathLength)
+                return false;
+            entry.outputs.push_back({ std::string(cursor, pathLength), size });
+            cursor += pathLength;
+        }
+
+        if (!manifest.entries.empty() && manifest.entries.back().resourceIndex >= entry.resourceIndex)
+            return false;
+        manifest.entries.push_back(std::move(entry));
+    }
+
+    return cursor == end;
+}
+
+const ManifestEntry* findManifestEntry(const OutputManifest& manifest, uint32_t resourceIndex) {
+    auto entry = std::lower_bound(manifest.entries.begin(), manifest.entries.end(), resourceIndex,
+        [](const ManifestEntry& e, uint32_t index) { return e.resourceIndex < index; });
+    if (entry == manifest.entries.end() || entry->resourceIndex != resourceIndex)
+        return nullptr;
+    return &*entry;
+}
+
+bool areManifestOutputsCurrent(const ManifestEntry& entry) {
+    for (const ManifestOutput& output : entry.outputs) {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(output.path, error);
+        if (error || size != output.size)
+            return false;
+    }
+    return true;
+}
+
+bool recordManifestOutputs(ManifestEntry& entry, const std::vector<std::string>& paths) {
+    entry.outputs.clear();
+    for (const std::string& path : paths) {
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(path, error);
+        if (error)
+            return false;
+        entry.outputs.push_back({ path, static_cast<uint64_t>(size) });
+    }
+    return true;
+}
@@ -0,0 +1,563 @@
+// OutputWriter.cpp : Background writer for extracted files, io_uring on Linux with writer threads as fallback.
+//
+
+#include "headers/OutputWriter.h"
+#include "headers/FrameStore.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(SANIT_HAVE_IO_URING)
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+bool writeOutputFile(const std::string& path, const void* data, size_t size) {
+    detachOutputFile(path);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write(static_cast<const char*>(data), size);
+    return static_cast<bool>(file);
+}
+
+bool copyOutputFile(const std::string& path, int sourceFd, uint64_t sourceOffset, const void* data, size_t size) {
+#if defined(__linux__)
+    if (sourceFd < 0 || size == 0)
+        return writeOutputFile(path, data, size);
+
+    detachOutputFile(path);
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return false;
+
+    loff_t offset = static_cast<loff_t>(sourceOffset);
+    size_t copied = 0;
+    while (copied < size) {
+        ssize_t result = copy_file_range(sourceFd, &offset, fd, nullptr, size - copied, 0);
+        if (result < 0 && errno == EINTR)
+            continue;
+        // EXDEV, EOPNOTSUPP, ENOSYS and the like, the rest is written from memory
+        if (result <= 0)
+            break;
+        copied += static_cast<size_t>(result);
+    }
+
+    const char* rest = static_cast<const char*>(data);
+    while (copied < size) {
+        ssize_t result = write(fd, rest + copied, size - copied);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        copied += static_cast<size_t>(result);
+    }
+
+    return close(fd) == 0 && copied == size;
+#else
+    (void)sourceFd;
+    (void)sourceOffset;
+    return writeOutputFile(path, data, size);
+#endif
+}
+
+#if defined(SANIT_HAVE_IO_URING)
+// Submission and completion rings shared with the kernel, driven through the raw system calls
+// so there's no dependency on liburing
+struct OutputWriter::Ring {
+    int fd = -1;
+    unsigned entries = 0;
+
+    void* sqMap = nullptr;
+    size_t sqMapSize = 0;
+    void* cqMap = nullptr;
+    size_t cqMapSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned* sqTail = nullptr;
+    unsigned* sqMask = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() {
+        if (sqes)
+            munmap(sqes, sqesSize);
+        if (cqMap && cqMap != sqMap)
+            munmap(cqMap, cqMapSize);
+        if (sqMap)
+            munmap(sqMap, sqMapSize);
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool setup(unsigned requestedEntries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, requestedEntries, &params));
+        if (fd < 0)
+            return false;
+        entries = params.sq_entries;
+
+        sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqMapSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap) {
+            sqMapSize = cqMapSize = std::max(sqMapSize, cqMapSize);
+        }
+
+        sqMap = mmap(nullptr, sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqMap == MAP_FAILED) {
+            sqMap = nullptr;
+            return false;
+        }
+        cqMap = singleMap ? sqMap : mmap(nullptr, cqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqMap == MAP_FAILED) {
+            cqMap = nullptr;
+            return false;
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqesMap == MAP_FAILED)
+            return false;
+        sqes = static_cast<io_uring_sqe*>(sqesMap);
+
+        char* sq = static_cast<char*>(sqMap);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+        char* cq = static_cast<char*>(cqMap);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Queues a write of size bytes at file offset, the kernel sees it on the next enter
+    void pushWrite(int fileFd, const uint8_t* data, size_t size, uint64_t offset, uint64_t userData) {
+        unsigned tail = *sqTail;
+        unsigned index = tail & *sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fileFd;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(std::min<size_t>(size, size_t(1) << 30));
+        sqe.off = offset;
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // Submits the queued entries and waits for at least one completion
+    bool enter(unsigned toSubmit) {
+        while (true) {
+            long result = syscall(__NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result >= 0)
+                return true;
+            if (errno != EINTR)
+                return false;
+        }
+    }
+
+    template <typename Handler>
+    void reap(Handler handler) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes[head & *cqMask];
+            handler(cqe.user_data, cqe.res);
+            ++head;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+};
+#endif
+
+OutputWriter::OutputWriter(unsigned threadCount, size_t memoryLimit, bool useIoUring)
+    : memoryLimit(memoryLimit) {
+#if defined(SANIT_HAVE_IO_URING)
+    if (useIoUring && startRing()) {
+        activeBackend = Backend::IoUring;
+        threads.emplace_back(&OutputWriter::ringLoop, this);
+        return;
+    }
+#else
+    (void)useIoUring;
+#endif
+
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&OutputWriter::threadLoop, this);
+    }
+}
+
+OutputWriter::OutputWriter(const std::string& packPath, size_t memoryLimit)
+    : activeBackend(Backend::Pack), memoryLimit(memoryLimit) {
+    if (!pack.open(packPath)) {
+        std::cerr << "Failed to create pack file: " << packPath << std::endl;
+    }
+
+    // The pack is one sequential file, a single thread writes it in submission order
+    threads.emplace_back(&OutputWriter::threadLoop, this);
+}
+
+OutputWriter::OutputWriter(OutputWriter& shared)
+    : activeBackend(shared.activeBackend), memoryLimit(shared.memoryLimit), target(shared.target) {
+}
+
+OutputWriter::~OutputWriter() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    if (pack.isOpen() && !pack.close()) {
+        std::cerr << "Failed to write the pack index" << std::endl;
+    }
+}
+
+void OutputWriter::submit(const std::string& path, std::vector<uint8_t> buffer) {
+    Job job;
+    job.path = path;
+    job.buffer = std::move(buffer);
+    job.data = job.buffer.data();
+    job.size = job.buffer.size();
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitView(const std::string& path, const void* data, size_t size) {
+    Job job;
+    job.path = path;
+    job.data = static_cast<const uint8_t*>(data);
+    job.size = size;
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitRange(const std::string& path, int sourceFd, uint64_t sourceOffset, const void* data, size_t size) {
+    Job job;
+    job.path = path;
+    job.data = static_cast<const uint8_t*>(data);
+    job.size = size;
+    job.sourceFd = sourceFd;
+    job.sourceOffset = sourceOffset;
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitLink(const std::string& existing, const std::string& path) {
+    Job job;
+    job.path = path;
+    job.linkSource = existing;
+    enqueue(std::move(job));
+}
+
+void OutputWriter::submitAppend(const std::string& path, std::vector<uint8_t> buffer) {
+    Job job;
+    job.path = path;
+    job.buffer = std::move(buffer);
+    job.data = job.buffer.data();
+    job.size = job.buffer.size();
+    job.append = true;
+    enqueue(std::move(job));
+}
+
+StageStats OutputWriter::stats() const {
+    if (target != this)
+        return target->stats();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    StageStats current = writeStats;
+    current.threads = static_cast<unsigned>(threads.size());
+    return current;
+}
+
+bool OutputWriter::flush() {
+    OutputWriter& writer = *target;
+    std::unique_lock<std::mutex> lock(writer.mutex);
+    writer.roomFreed.wait(lock, [&] { return unfinishedJobs == 0; });
+    bool success = !failed;
+    failed = false;
+    return success;
+}
+
+void OutputWriter::enqueue(Job job) {
+    if (!job.owner) {
+        job.owner = this;
+    }
+    if (target != this) {
+        target->enqueue(std::move(job));
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Backpressure, a buffer larger than the whole limit still goes through on its own
+    size_t bytes = job.buffer.size();
+    roomFreed.wait(lock, [&] { return queuedBytes == 0 || queuedBytes + bytes <= memoryLimit; });
+    queuedBytes += bytes;
+    ++job.owner->unfinishedJobs;
+
+    // An append waits until the earlier parts of its file are written, it only counts as
+    // pending for the file once it's released so the appends go one after the other
+    if (job.append && pendingWrites.count(job.path) > 0) {
+        std::string key = job.path;
+        waitingJobs[key].push_back(std::move(job));
+        return;
+    }
+
+    // A link has to wait until its source is on disk
+    ++pendingWrites[job.path];
+    if (!job.linkSource.empty() && pendingWrites.count(job.linkSource) > 0) {
+        std::string key = job.linkSource;
+        waitingJobs[key].push_back(std::move(job));
+        return;
+    }
+
+    jobs.push_back(std::move(job));
+    lock.unlock();
+    jobReady.notify_one();
+}
+
+bool OutputWriter::takeJob(Job& job, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wait && jobs.empty() && !stopping) {
+        const auto start = std::chrono::steady_clock::now();
+        jobReady.wait(lock, [&] { return stopping || !jobs.empty(); });
+        writeStats.starvedNanos += pipelineNanosSince(start);
+    }
+    if (jobs.empty())
+        return false;
+
+    job = std::move(jobs.front());
+    jobs.pop_front();
+    return true;
+}
+
+void OutputWriter::finishJob(const Job& job, bool success) {
+    if (!success) {
+        std::cerr << "Failed to write output file: " << job.path << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    queuedBytes -= job.buffer.size();
+    --job.owner->unfinishedJobs;
+    ++writeStats.items;
+    job.owner->failed = job.owner->failed || !success;
+
+    auto pending = pendingWrites.find(job.path);
+    if (pending != pendingWrites.end() && --pending->second == 0) {
+        pendingWrites.erase(pending);
+
+        // Links to this file can go now, and the next append to it
+        auto waiting = waitingJobs.find(job.path);
+        if (waiting != waitingJobs.end()) {
+            std::vector<Job> stillWaiting;
+            bool appendReleased = false;
+            for (Job& next : waiting->second) {
+                if (next.append && appendReleased) {
+                    stillWaiting.push_back(std::move(next));
+                    continue;
+                }
+                if (next.append) {
+                    ++pendingWrites[job.path];
+                    appendReleased = true;
+                }
+                jobs.push_back(std::move(next));
+            }
+
+            if (stillWaiting.empty()) {
+                waitingJobs.erase(waiting);
+            }
+            else {
+                waiting->second = std::move(stillWaiting);
+            }
+            jobReady.notify_all();
+        }
+    }
+    roomFreed.notify_all();
+}
+
+void OutputWriter::recordBusy(uint64_t nanos) {
+    std::lock_guard<std::mutex> lock(mutex);
+    writeStats.busyNanos += nanos;
+}
+
+bool OutputWriter::runJob(const Job& job) {
+    if (activeBackend == Backend::Pack) {
+        if (!pack.isOpen())
+            return false;
+        if (job.append)
+            return pack.append(job.path, job.data, job.size);
+        if (job.linkSource.empty())
+            return pack.add(job.path, job.data, job.size);
+        if (pack.alias(job.linkSource, job.path))
+            return true;
+
+        // Source from outside the pack (an earlier run), store a copy of it
+        std::ifstream source(job.linkSource, std::ios::binary);
+        if (!source)
+            return false;
+        std::vector<char> content((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+        return pack.add(job.path, content.data(), content.size());
+    }
+
+    if (job.append) {
+        std::ofstream file(job.path, std::ios::binary | std::ios::app);
+        file.write(reinterpret_cast<const char*>(job.data), job.size);
+        return static_cast<bool>(file);
+    }
+    if (!job.linkSource.empty())
+        return linkOutputFile(job.linkSource, job.path);
+    if (job.sourceFd >= 0)
+        return copyOutputFile(job.path, job.sourceFd, job.sourceOffset, job.data, job.size);
+    return writeOutputFile(job.path, job.data, job.size);
+}
+
+void OutputWriter::threadLoop() {
+    Job job;
+    while (takeJob(job, true)) {
+        const auto start = std::chrono::steady_clock::now();
+        bool success = runJob(job);
+        recordBusy(pipelineNanosSince(start));
+        finishJob(job, success);
+    }
+}
+
+#if defined(SANIT_HAVE_IO_URING)
+bool OutputWriter::startRing() {
+    ring = std::make_unique<Ring>();
+    if (!ring->setup(64)) {
+        ring.reset();
+        return false;
+    }
+    return true;
+}
+
+void OutputWriter::ringLoop() {
+    struct Slot {
+        Job job;
+        int fd = -1;
+        size_t written = 0;
+        bool used = false;
+    };
+    std::vector<Slot> slots(ring->entries);
+    size_t inFlight = 0;
+    unsigned toSubmit = 0;
+
+    auto complete = [&](Slot& slot, bool success) {
+        close(slot.fd);
+        finishJob(slot.job, success);
+        slot = Slot();
+        --inFlight;
+    };
+
+    // Busy from the moment there's something to write until the ring runs dry
+    auto busySince = std::chrono::steady_clock::now();
+    auto takeNext = [&](Job& job) {
+        if (inFlight > 0 || toSubmit > 0)
+            return takeJob(job, false);
+
+        recordBusy(pipelineNanosSince(busySince));
+        bool taken = takeJob(job, true);
+        busySince = std::chrono::steady_clock::now();
+        return taken;
+    };
+
+    while (true) {
+        // Fill the free slots, only block for new jobs when nothing is being written
+        Job job;
+        while (inFlight < slots.size() && takeNext(job)) {
+            // Links, appends, kernel copies and empty files are written right here, no need for the ring
+            if (!job.linkSource.empty() || job.append || job.sourceFd >= 0 || job.size == 0) {
+                bool success = runJob(job);
+                finishJob(job, success);
+                continue;
+            }
+
+            detachOutputFile(job.path);
+            int fd = open(job.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (fd < 0) {
+                finishJob(job, false);
+                continue;
+            }
+
+            size_t index = std::find_if(slots.begin(), slots.end(), [](const Slot& slot) { return !slot.used; }) - slots.begin();
+            Slot& slot = slots[index];
+            slot.job = std::move(job);
+            slot.fd = fd;
+            slot.used = true;
+            ring->pushWrite(fd, slot.job.data, slot.job.size, 0, index);
+            ++toSubmit;
+            ++inFlight;
+        }
+
+        if (inFlight == 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping && jobs.empty())
+                return;
+            continue;
+        }
+
+        if (!ring->enter(toSubmit)) {
+            // The ring broke down, finish what's in flight the plain way
+            for (Slot& slot : slots) {
+                if (slot.used) {
+                    close(slot.fd);
+                    finishJob(slot.job, writeOutputFile(slot.job.path, slot.job.data, slot.job.size));
+                    slot = Slot();
+                }
+            }
+            inFlight = 0;
+            toSubmit = 0;
+            continue;
+        }
+        toSubmit = 0;
+
+        ring->reap([&](uint64_t index, int result) {
+            Slot& slot = slots[index];
+            if (result == -EINTR || result == -EAGAIN) {
+                ring->pushWrite(slot.fd, slot.job.data + slot.written, slot.job.size - slot.written, slot.written, index);
+                ++toSubmit;
+                return;
+            }
+            if (result <= 0) {
+                complete(slot, false);
+                return;
+            }
+
+            // Short write, queue the rest
+            slot.written += static_cast<size_t>(result);
+            if (slot.written < slot.job.size) {
+                ring->pushWrite(slot.fd, slot.job.data + slot.written, slot.job.size - slot.written, slot.written, index);
+                ++toSubmit;
+                return;
+            }
+            complete(slot, true);
+            });
+    }
+}
+#endif
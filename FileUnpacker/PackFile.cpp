@@ -0,0 +1,156 @@
+// PackFile.cpp : Single file container for extraction output.
+//
+
+#include "headers/PackFile.h"
+
+#include <cstring>
+
+// Layout, all fields little endian:
+//   header  "SPAK", u32 version
+//   data    contents of the entries, back to back
+//   index   per entry: u64 offset, u64 size, u16 name length, name (UTF-8, '/' separated)
+//   footer  u64 index offset, u32 entry count, "SPAK"
+static const char kPackMagic[4] = { 'S', 'P', 'A', 'K' };
+static const uint32_t kPackVersion = 1;
+
+static const size_t kHeaderSize = 8;
+static const size_t kFooterSize = 16;
+static const size_t kEntryFixedSize = 18;
+
+static void putLE(std::vector<char>& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint64_t getLE(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+PackWriter::~PackWriter() {
+    if (file.is_open()) {
+        close();
+    }
+}
+
+bool PackWriter::open(const std::string& path) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    std::vector<char> header;
+    header.insert(header.end(), kPackMagic, kPackMagic + 4);
+    putLE(header, kPackVersion, 4);
+    file.write(header.data(), header.size());
+
+    position = kHeaderSize;
+    entries.clear();
+    lookup.clear();
+    return static_cast<bool>(file);
+}
+
+bool PackWriter::add(const std::string& name, const void* data, size_t size) {
+    if (name.size() > UINT16_MAX)
+        return false;
+
+    file.write(static_cast<const char*>(data), size);
+    lookup[name] = entries.size();
+    entries.push_back({ name, position, size });
+    position += size;
+    return static_cast<bool>(file);
+}
+
+bool PackWriter::append(const std::string& name, const void* data, size_t size) {
+    if (entries.empty() || entries.back().name != name)
+        return add(name, data, size);
+
+    file.write(static_cast<const char*>(data), size);
+    entries.back().size += size;
+    position += size;
+    return static_cast<bool>(file);
+}
+
+bool PackWriter::alias(const std::string& existing, const std::string& name) {
+    auto source = lookup.find(existing);
+    if (source == lookup.end() || name.size() > UINT16_MAX)
+        return false;
+
+    PackEntry entry = entries[source->second];
+    entry.name = name;
+    lookup[name] = entries.size();
+    entries.push_back(entry);
+    return true;
+}
+
+bool PackWriter::close() {
+    std::vector<char> index;
+    for (const PackEntry& entry : entries) {
+        putLE(index, entry.offset, 8);
+        putLE(index, entry.size, 8);
+        putLE(index, entry.name.size(), 2);
+        index.insert(index.end(), entry.name.begin(), entry.name.end());
+    }
+    putLE(index, position, 8);
+    putLE(index, entries.size(), 4);
+    index.insert(index.end(), kPackMagic, kPackMagic + 4);
+
+    file.write(index.data(), index.size());
+    bool success = static_cast<bool>(file);
+    file.close();
+    return success;
+}
+
+bool PackReader::open(const std::string& path) {
+    packEntries.clear();
+    lookup.clear();
+    if (!input.open(path) || input.size() < kHeaderSize + kFooterSize)
+        return false;
+
+    const char* data = input.data();
+    const size_t size = input.size();
+    if (std::memcmp(data, kPackMagic, 4) != 0 || getLE(data + 4, 4) != kPackVersion)
+        return false;
+
+    const char* footer = data + size - kFooterSize;
+    if (std::memcmp(footer + 12, kPackMagic, 4) != 0)
+        return false;
+    uint64_t indexOffset = getLE(footer, 8);
+    size_t entryCount = static_cast<size_t>(getLE(footer + 8, 4));
+    if (indexOffset < kHeaderSize || indexOffset > size - kFooterSize)
+        return false;
+
+    // Every entry is checked against the pack, so data() can be trusted afterwards
+    const char* entry = data + indexOffset;
+    const char* indexEnd = footer;
+    packEntries.reserve(entryCount);
+    for (size_t i = 0; i < entryCount; ++i) {
+        if (static_cast<size_t>(indexEnd - entry) < kEntryFixedSize)
+            return false;
+
+        PackEntry packEntry;
+        packEntry.offset = getLE(entry, 8);
+        packEntry.size = getLE(entry + 8, 8);
+        size_t nameLength = static_cast<size_t>(getLE(entry + 16, 2));
+        entry += kEntryFixedSize;
+        if (static_cast<size_t>(indexEnd - entry) < nameLength)
+            return false;
+        if (packEntry.offset > indexOffset || packEntry.size > indexOffset - packEntry.offset)
+            return false;
+
+        packEntry.name.assign(entry, nameLength);
+        entry += nameLength;
+
+        lookup[packEntry.name] = packEntries.size();
+        packEntries.push_back(std::move(packEntry));
+    }
+    return entry == indexEnd;
+}
+
+const PackEntry* PackReader::find(const std::string& name) const {
+    auto entry = lookup.find(name);
+    return entry == lookup.end() ? nullptr : &packEntries[entry->second];
+}
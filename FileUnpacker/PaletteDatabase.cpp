@@ -0,0 +1,142 @@
+// PaletteDatabase.cpp : Reads and writes the binary file holding the palettes and the RES file to palette mapping.
+//
+
+#include "headers/PaletteDatabase.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+// Layout, all fields little endian:
+//   header    "SPAL", u32 version, u32 palette count, u32 mapping count, u32 default palette
+//   palettes  256 colors of R, G, B
+//   mappings  archive name padded with zeros to 16 bytes, u32 palette, ordered by name
+static const char kPaletteMagic[4] = { 'S', 'P', 'A', 'L' };
+static const uint32_t kPaletteVersion = 1;
+
+static const size_t kHeaderSize = 20;
+static const size_t kNameSize = 16;
+static const size_t kMappingSize = kNameSize + 4;
+
+static void putLE(std::vector<char>& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint64_t getLE(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+static std::string_view mappingName(const char* record) {
+    return std::string_view(record, strnlen(record, kNameSize));
+}
+
+bool PaletteDatabase::open(const std::string& path) {
+    palettes = 0;
+    mappings = 0;
+    if (!input.open(path) || input.size() < kHeaderSize) {
+        input.close();
+        return false;
+    }
+
+    const char* data = input.data();
+    size_t paletteTotal = static_cast<size_t>(getLE(data + 8, 4));
+    size_t mappingTotal = static_cast<size_t>(getLE(data + 12, 4));
+    if (std::memcmp(data, kPaletteMagic, 4) != 0 || getLE(data + 4, 4) != kPaletteVersion ||
+        input.size() != kHeaderSize + paletteTotal * kPaletteSize + mappingTotal * kMappingSize) {
+        input.close();
+        return false;
+    }
+
+    // Palette numbers in the mappings are checked when they're looked up, nothing else is read here
+    palettes = paletteTotal;
+    mappings = mappingTotal;
+    defaultIndex = static_cast<uint32_t>(getLE(data + 16, 4));
+    return true;
+}
+
+std::span<const uint8_t> PaletteDatabase::palette(size_t index) const {
+    if (index >= palettes)
+        return {};
+    return { reinterpret_cast<const uint8_t*>(input.data() + kHeaderSize + index * kPaletteSize), kPaletteSize };
+}
+
+std::span<const uint8_t> PaletteDatabase::paletteFor(std::string_view archiveName) const {
+    if (mappings == 0)
+        return {};
+
+    // Binary search over the records in place
+    const char* records = input.data() + kHeaderSize + palettes * kPaletteSize;
+    size_t low = 0;
+    size_t high = mappings;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        std::string_view name = mappingName(records + middle * kMappingSize);
+        if (name == archiveName)
+            return palette(static_cast<size_t>(getLE(records + middle * kMappingSize + kNameSize, 4)));
+        if (name < archiveName) {
+            low = middle + 1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return {};
+}
+
+PaletteMapping PaletteDatabase::mapping(size_t index) const {
+    const char* record = input.data() + kHeaderSize + palettes * kPaletteSize + index * kMappingSize;
+    return { std::string(mappingName(record)), static_cast<uint32_t>(getLE(record + kNameSize, 4)) };
+}
+
+bool writePaletteDatabase(const std::string& path, const std::vector<std::vector<uint8_t>>& palettes, std::vector<PaletteMapping> mappings,
+    uint32_t defaultPaletteIndex) {
+    std::sort(mappings.begin(), mappings.end(), [](const PaletteMapping& a, const PaletteMapping& b) { return a.archiveName < b.archiveName; });
+
+    std::vector<char> out;
+    out.reserve(kHeaderSize + palettes.size() * kPaletteSize + mappings.size() * kMappingSize);
+    out.insert(out.end(), kPaletteMagic, kPaletteMagic + 4);
+    putLE(out, kPaletteVersion, 4);
+    putLE(out, palettes.size(), 4);
+    putLE(out, mappings.size(), 4);
+    putLE(out, defaultPaletteIndex, 4);
+
+    for (const std::vector<uint8_t>& palette : palettes) {
+        if (palette.size() != kPaletteSize)
+            return false;
+        out.insert(out.end(), palette.begin(), palette.end());
+    }
+    for (size_t i = 0; i < mappings.size(); ++i) {
+        const PaletteMapping& mapping = mappings[i];
+        if (mapping.archiveName.empty() || mapping.archiveName.size() > kNameSize || mapping.paletteIndex >= palettes.size())
+            return false;
+        if (i > 0 && mappings[i - 1].archiveName == mapping.archiveName)
+            return false;
+        out.insert(out.end(), mapping.archiveName.begin(), mapping.archiveName.end());
+        out.insert(out.end(), kNameSize - mapping.archiveName.size(), '\0');
+        putLE(out, mapping.paletteIndex, 4);
+    }
+
+    // Written next to the old one and renamed over it, so a database that is open elsewhere stays intact
+    const std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(out.data(), out.size()))
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
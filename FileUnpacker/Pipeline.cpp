@@ -0,0 +1,91 @@
+// Pipeline.cpp : Stage tasks and statistics for the extraction pipeline.
+//
+
+#include "headers/Pipeline.h"
+
+#include <algorithm>
+#include <iomanip>
+
+StageStats& StageStats::operator+=(const StageStats& other) {
+    threads += other.threads;
+    busyNanos += other.busyNanos;
+    starvedNanos += other.starvedNanos;
+    queuedNanos += other.queuedNanos;
+    blockedNanos += other.blockedNanos;
+    items += other.items;
+    return *this;
+}
+
+PipelineStage::PipelineStage(std::string name, ThreadPool& pool, TaskGroup& group, unsigned maxTasks)
+    : stageName(std::move(name)), pool(pool), group(group), maxTasks(maxTasks) {
+}
+
+void PipelineStage::submit(std::function<void()> body, uint64_t itemCount) {
+    WaitingTask task = { std::move(body), itemCount, std::chrono::steady_clock::now() };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (maxTasks != 0 && runningTasks >= maxTasks) {
+            // Counted as pending in the group, so waiting for the group covers it
+            group.pending.fetch_add(1);
+            waiting.push_back(std::move(task));
+            return;
+        }
+        ++runningTasks;
+    }
+    launch(std::move(task));
+}
+
+void PipelineStage::launch(WaitingTask task) {
+    pool.submit(group, [this, task = std::move(task)] {
+        queuedNanos.fetch_add(pipelineNanosSince(task.queuedAt), std::memory_order_relaxed);
+        const auto start = std::chrono::steady_clock::now();
+        task.body();
+        record(pipelineNanosSince(start), task.items);
+
+        // Hand the slot to the next waiting task, this task keeps the group pending until it's submitted
+        WaitingTask next;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (waiting.empty()) {
+                --runningTasks;
+                return;
+            }
+            next = std::move(waiting.front());
+            waiting.pop_front();
+        }
+        launch(std::move(next));
+        group.pending.fetch_sub(1);
+        });
+}
+
+void PipelineStage::record(uint64_t nanos, uint64_t count) {
+    busyNanos.fetch_add(nanos, std::memory_order_relaxed);
+    items.fetch_add(count, std::memory_order_relaxed);
+}
+
+void PipelineStage::recordBlocked(uint64_t nanos) {
+    blockedNanos.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+StageStats PipelineStage::stats() const {
+    StageStats totals;
+    totals.threads = maxTasks != 0 ? std::min(maxTasks, pool.threadCount()) : pool.threadCount();
+    totals.busyNanos = busyNanos.load(std::memory_order_relaxed);
+    totals.queuedNanos = queuedNanos.load(std::memory_order_relaxed);
+    totals.blockedNanos = blockedNanos.load(std::memory_order_relaxed);
+    totals.items = items.load(std::memory_order_relaxed);
+    return totals;
+}
+
+void printStageStats(std::ostream& out, const std::string& name, const StageStats& stats, uint64_t wallNanos, bool pooled) {
+    auto seconds = [](uint64_t nanos) { return static_cast<double>(nanos) / 1e9; };
+    double capacity = static_cast<double>(wallNanos) * std::max(1u, stats.threads);
+    double utilization = capacity > 0 ? 100.0 * static_cast<double>(stats.busyNanos) / capacity : 0.0;
+
+    out << "  " << std::left << std::setw(7) << name << std::right << stats.threads << " thread(s), "
+        << std::fixed << std::setprecision(3)
+        << "busy " << seconds(stats.busyNanos) << " s, " << (pooled ? "queued " : "starved ")
+        << seconds(pooled ? stats.queuedNanos : stats.starvedNanos)
+        << " s, blocked " << seconds(stats.blockedNanos) << " s, " << stats.items << " items ("
+        << std::setprecision(0) << utilization << "% busy)" << std::defaultfloat << std::setprecision(6) << std::endl;
+}
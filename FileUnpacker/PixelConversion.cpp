@@ -0,0 +1,208 @@
+// PixelConversion.cpp : Palette index to BGR conversion used by the BMP writers.
+//
+
+#include "headers/PixelConversion.h"
+#include "headers/CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+
+static inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+static inline unsigned highestSetBit(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return 31u - static_cast<unsigned>(__builtin_clz(mask));
+#endif
+}
+
+PaletteLUT buildPaletteLUT(std::span<const uint8_t> palette) {
+    PaletteLUT lut;
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t r = i, g = i, b = i;
+        if (palette.size() >= (i + 1) * 3) {
+            r = palette[i * 3];
+            g = palette[i * 3 + 1];
+            b = palette[i * 3 + 2];
+        }
+        lut.bgra[i] = b | (g << 8) | (r << 16) | (0xFFu << 24);
+    }
+    return lut;
+}
+
+uint8_t findNearestPaletteIndex(const PaletteLUT& lut, uint8_t r, uint8_t g, uint8_t b) {
+    uint8_t nearest = 0;
+    uint32_t nearestDistance = UINT32_MAX;
+    for (uint32_t i = 0; i < 256; ++i) {
+        int db = static_cast<int>(lut.bgra[i] & 0xFF) - b;
+        int dg = static_cast<int>((lut.bgra[i] >> 8) & 0xFF) - g;
+        int dr = static_cast<int>((lut.bgra[i] >> 16) & 0xFF) - r;
+        uint32_t distance = static_cast<uint32_t>(dr * dr + dg * dg + db * db);
+        if (distance < nearestDistance) {
+            nearest = static_cast<uint8_t>(i);
+            nearestDistance = distance;
+        }
+    }
+    return nearest;
+}
+
+void convertIndicesToBGRScalar(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out) {
+    if (count == 0)
+        return;
+
+    // Four byte stores that overlap by one, the alpha byte gets overwritten by the next pixel
+    for (size_t i = 0; i + 1 < count; ++i) {
+        std::memcpy(out + i * 3, &lut.bgra[indices[i]], 4);
+    }
+
+    // Last pixel can't spill past the output
+    uint32_t last = lut.bgra[indices[count - 1]];
+    out[(count - 1) * 3] = static_cast<uint8_t>(last);
+    out[(count - 1) * 3 + 1] = static_cast<uint8_t>(last >> 8);
+    out[(count - 1) * 3 + 2] = static_cast<uint8_t>(last >> 16);
+}
+
+#if defined(SANIT_HAVE_AVX2)
+SANIT_TARGET_AVX2
+static void convertIndicesToBGRAVX2Impl(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out) {
+    // Packs the four BGRA words of each 128-bit lane into 12 BGR bytes at the bottom of the lane
+    const __m256i packBGR = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const int* table = reinterpret_cast<const int*>(lut.bgra);
+
+    size_t i = 0;
+    // Each step writes 28 bytes for 24 bytes of output, keep the spill inside the buffer
+    for (; i + 10 <= count; i += 8) {
+        __m128i packedIndices = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + i));
+        __m256i wideIndices = _mm256_cvtepu8_epi32(packedIndices);
+        __m256i colors = _mm256_i32gather_epi32(table, wideIndices, 4);
+        __m256i bgr = _mm256_shuffle_epi8(colors, packBGR);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3), _mm256_castsi256_si128(bgr));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i * 3 + 12), _mm256_extracti128_si256(bgr, 1));
+    }
+
+    convertIndicesToBGRScalar(indices + i, count - i, lut, out + i * 3);
+}
+#endif
+
+void convertIndicesToBGRAVX2(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out) {
+#if defined(SANIT_HAVE_AVX2)
+    if (cpuSupportsAVX2()) {
+        convertIndicesToBGRAVX2Impl(indices, count, lut, out);
+        return;
+    }
+#endif
+    convertIndicesToBGRScalar(indices, count, lut, out);
+}
+
+void convertIndicesToBGR(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out) {
+    using ConversionKernel = void(*)(const uint8_t*, size_t, const PaletteLUT&, uint8_t*);
+
+    static const ConversionKernel kernel = [] {
+#if defined(SANIT_HAVE_AVX2)
+        if (cpuSupportsAVX2())
+            return static_cast<ConversionKernel>(convertIndicesToBGRAVX2Impl);
+#endif
+        return static_cast<ConversionKernel>(convertIndicesToBGRScalar);
+    }();
+
+    kernel(indices, count, lut, out);
+}
+
+size_t findFirstOpaqueScalar(const uint8_t* indices, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        if (indices[i] != 0)
+            return i;
+    }
+    return count;
+}
+
+size_t findFirstOpaqueSSE2(const uint8_t* indices, size_t count) {
+#if defined(SANIT_HAVE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        uint32_t transparent = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+        if (transparent != 0xFFFF) {
+            return i + countTrailingZeros(~transparent & 0xFFFF);
+        }
+    }
+    return i + findFirstOpaqueScalar(indices + i, count - i);
+#else
+    return findFirstOpaqueScalar(indices, count);
+#endif
+}
+
+size_t findOpaqueEndScalar(const uint8_t* indices, size_t count) {
+    while (count > 0 && indices[count - 1] == 0) {
+        --count;
+    }
+    return count;
+}
+
+size_t findOpaqueEndSSE2(const uint8_t* indices, size_t count) {
+#if defined(SANIT_HAVE_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    // Blocks from the end of the row
+    while (count >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + count - 16));
+        uint32_t transparent = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, zero)));
+        if (transparent != 0xFFFF) {
+            return count - 16 + highestSetBit(~transparent & 0xFFFF) + 1;
+        }
+        count -= 16;
+    }
+    return findOpaqueEndScalar(indices, count);
+#else
+    return findOpaqueEndScalar(indices, count);
+#endif
+}
+
+FrameBounds findOpaqueBounds(const uint8_t* indices, uint32_t width, uint32_t height) {
+    FrameBounds bounds;
+
+    // First and last rows with anything in them
+    uint32_t top = 0;
+    while (top < height && findFirstOpaqueSSE2(indices + static_cast<size_t>(top) * width, width) == width) {
+        ++top;
+    }
+    if (top == height)
+        return bounds;
+
+    uint32_t bottom = height;
+    while (findFirstOpaqueSSE2(indices + static_cast<size_t>(bottom - 1) * width, width) == width) {
+        --bottom;
+    }
+
+    // Columns, each row only has to be checked outside the extent found so far
+    const uint8_t* topRow = indices + static_cast<size_t>(top) * width;
+    size_t left = findFirstOpaqueSSE2(topRow, width);
+    size_t right = findOpaqueEndSSE2(topRow, width);
+    for (uint32_t y = top + 1; y < bottom; ++y) {
+        const uint8_t* row = indices + static_cast<size_t>(y) * width;
+        left = std::min(left, findFirstOpaqueSSE2(row, left));
+        right += findOpaqueEndSSE2(row + right, width - right);
+    }
+
+    bounds.x = static_cast<uint32_t>(left);
+    bounds.y = top;
+    bounds.width = static_cast<uint32_t>(right - left);
+    bounds.height = bottom - top;
+    return bounds;
+}
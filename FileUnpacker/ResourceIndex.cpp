@@ -0,0 +1,147 @@
+// ResourceIndex.cpp : Reads and writes the binary table of contents sidecar of RES files.
+//
+
+#include "headers/ResourceIndex.h"
+#include "headers/Hash.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+// Layout, all fields little endian:
+//   header    "STOC", u32 version, u64 archive size, i64 modified, u64 hash, u32 format mask,
+//             u32 resource count, u32 frame count
+//   resources u64 offset, u32 size, u32 first frame, u16 frame count, u8 format, u8 reserved
+//   frames    u32 offset, u16 width, u16 height
+static const char kIndexMagic[4] = { 'S', 'T', 'O', 'C' };
+static const uint32_t kIndexVersion = 2;   // 2: D3GR frame tables are validated, older indexes may list stray signatures
+
+static const size_t kHeaderSize = 44;
+static const size_t kResourceEntrySize = 20;
+static const size_t kFrameEntrySize = 8;
+
+static void putLE(std::vector<char>& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint64_t getLE(const char* data, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(data[i])) << (i * 8);
+    }
+    return value;
+}
+
+std::string resourceIndexPath(const std::string& archivePath, const std::string& formatsTag) {
+    return archivePath + "." + formatsTag + ".toc";
+}
+
+int64_t fileModifiedTime(const std::string& path) {
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error)
+        return 0;
+    return static_cast<int64_t>(modified.time_since_epoch().count());
+}
+
+bool writeResourceIndex(const std::string& indexPath, const ResourceIndex& index) {
+    std::vector<char> out;
+    out.reserve(kHeaderSize + index.resources.size() * kResourceEntrySize + index.frames.size() * kFrameEntrySize);
+
+    out.insert(out.end(), kIndexMagic, kIndexMagic + 4);
+    putLE(out, kIndexVersion, 4);
+    putLE(out, index.archiveSize, 8);
+    putLE(out, static_cast<uint64_t>(index.archiveModified), 8);
+    putLE(out, index.archiveHash, 8);
+    putLE(out, index.formatMask, 4);
+    putLE(out, index.resources.size(), 4);
+    putLE(out, index.frames.size(), 4);
+
+    for (const IndexedResource& resource : index.resources) {
+        putLE(out, resource.offset, 8);
+        putLE(out, resource.size, 4);
+        putLE(out, resource.firstFrame, 4);
+        putLE(out, resource.frameCount, 2);
+        putLE(out, resource.format, 1);
+        putLE(out, 0, 1);
+    }
+
+    for (const IndexedFrame& frame : index.frames) {
+        putLE(out, frame.offset, 4);
+        putLE(out, frame.width, 2);
+        putLE(out, frame.height, 2);
+    }
+
+    std::ofstream file(indexPath, std::ios::binary);
+    if (!file)
+        return false;
+
+    file.write(out.data(), out.size());
+    return static_cast<bool>(file);
+}
+
+bool readResourceIndex(const std::string& indexPath, ResourceIndex& index) {
+    std::ifstream file(indexPath, std::ios::binary | std::ios::ate);
+    if (!file)
+        return false;
+
+    std::streamoff fileSize = file.tellg();
+    if (fileSize < static_cast<std::streamoff>(kHeaderSize))
+        return false;
+
+    std::vector<char> data(static_cast<size_t>(fileSize));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(data.data(), fileSize))
+        return false;
+
+    if (std::memcmp(data.data(), kIndexMagic, 4) != 0 || getLE(&data[4], 4) != kIndexVersion)
+        return false;
+
+    index.archiveSize = getLE(&data[8], 8);
+    index.archiveModified = static_cast<int64_t>(getLE(&data[16], 8));
+    index.archiveHash = getLE(&data[24], 8);
+    index.formatMask = static_cast<uint32_t>(getLE(&data[32], 4));
+    size_t resourceCount = static_cast<size_t>(getLE(&data[36], 4));
+    size_t frameCount = static_cast<size_t>(getLE(&data[40], 4));
+
+    if (data.size() != kHeaderSize + resourceCount * kResourceEntrySize + frameCount * kFrameEntrySize)
+        return false;
+
+    index.resources.resize(resourceCount);
+    const char* entry = data.data() + kHeaderSize;
+    for (IndexedResource& resource : index.resources) {
+        resource.offset = getLE(entry, 8);
+        resource.size = static_cast<uint32_t>(getLE(entry + 8, 4));
+        resource.firstFrame = static_cast<uint32_t>(getLE(entry + 12, 4));
+        resource.frameCount = static_cast<uint16_t>(getLE(entry + 16, 2));
+        resource.format = static_cast<uint8_t>(getLE(entry + 18, 1));
+        entry += kResourceEntrySize;
+
+        if (static_cast<size_t>(resource.firstFrame) + resource.frameCount > frameCount)
+            return false;
+    }
+
+    index.frames.resize(frameCount);
+    for (IndexedFrame& frame : index.frames) {
+        frame.offset = static_cast<uint32_t>(getLE(entry, 4));
+        frame.width = static_cast<uint16_t>(getLE(entry + 4, 2));
+        frame.height = static_cast<uint16_t>(getLE(entry + 6, 2));
+        entry += kFrameEntrySize;
+    }
+
+    return true;
+}
+
+bool isResourceIndexCurrent(const ResourceIndex& index, const std::string& archivePath, const char* data, size_t size) {
+    if (index.archiveSize != size)
+        return false;
+
+    if (index.archiveModified == fileModifiedTime(archivePath))
+        return true;
+
+    // Same size but touched, only the content can tell
+    return data != nullptr && hashBytes(data, size) == index.archiveHash;
+}
@@ -0,0 +1,140 @@
+// ResourceViews.cpp : In-place parsing of the D3GR and WAV resources carved out of RES files.
+//
+
+#include "headers/ResourceViews.h"
+
+#include <algorithm>
+
+static bool hasTag(std::span<const std::byte> data, size_t offset, const char (&tag)[5]) {
+    for (size_t i = 0; i < 4; ++i) {
+        if (data[offset + i] != static_cast<std::byte>(tag[i]))
+            return false;
+    }
+    return true;
+}
+
+D3GRView::D3GRView(std::span<const std::byte> data)
+    : bytes(data) {
+    uint64_t extent = 0;
+    if (!checkFrameTable(data, extent) || extent > data.size())
+        return;
+
+    size_t count = readLE16(data, kFrameCountOffset);
+    size_t tableEnd = kFrameTableOffset + count * 4;
+    frameViews.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        size_t position = tableEnd + readLE32(data, kFrameTableOffset + i * 4);
+        uint16_t height = readLE16(data, position + FrameView::kHeightOffset);
+        uint16_t width = readLE16(data, position + FrameView::kWidthOffset);
+        frameViews.emplace_back(static_cast<uint32_t>(position), width, height,
+            data.subspan(position + FrameView::kHeaderSize, static_cast<size_t>(width) * height));
+    }
+    valid = true;
+}
+
+bool D3GRView::checkFrameTable(std::span<const std::byte> header, uint64_t& extent) {
+    if (header.size() < kFrameTableOffset)
+        return false;
+
+    size_t count = readLE16(header, kFrameCountOffset);
+    size_t tableEnd = kFrameTableOffset + count * 4;
+    if (count == 0 || tableEnd > header.size())
+        return false;
+
+    // Frames follow each other in table order, the same frame may be listed twice but they never overlap
+    extent = tableEnd;
+    uint64_t previousPosition = 0;
+    uint64_t previousEnd = tableEnd;
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t position = tableEnd + static_cast<uint64_t>(readLE32(header, kFrameTableOffset + i * 4));
+        if (position + FrameView::kHeaderSize > header.size())
+            return false;
+        if (i > 0 && position != previousPosition && position < previousEnd)
+            return false;
+
+        uint16_t height = readLE16(header, static_cast<size_t>(position) + FrameView::kHeightOffset);
+        uint16_t width = readLE16(header, static_cast<size_t>(position) + FrameView::kWidthOffset);
+        if (width > kMaxFrameDimension || height > kMaxFrameDimension)
+            return false;
+
+        previousPosition = position;
+        previousEnd = position + FrameView::kHeaderSize + static_cast<uint64_t>(width) * height;
+        extent = std::max(extent, previousEnd);
+    }
+    return extent <= UINT32_MAX;
+}
+
+size_t D3GRView::headerSize(std::span<const std::byte> available) {
+    // Frame count, the table and the header of the last frame in it
+    if (available.size() < kFrameTableOffset)
+        return kFrameTableOffset;
+
+    size_t count = readLE16(available, kFrameCountOffset);
+    size_t tableEnd = kFrameTableOffset + count * 4;
+    if (count == 0 || available.size() < tableEnd)
+        return tableEnd;
+
+    // Positions have to grow, so the last frame header is the furthest one. When they don't the table is
+    // rejected by measure without loading anything more.
+    uint32_t lastOffset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t offset = readLE32(available, kFrameTableOffset + i * 4);
+        if (offset < lastOffset)
+            return tableEnd;
+        lastOffset = offset;
+    }
+    return tableEnd + static_cast<size_t>(lastOffset) + FrameView::kHeaderSize;
+}
+
+uint32_t D3GRView::measure(std::span<const std::byte> header) {
+    uint64_t extent = 0;
+    if (headerSize(header) > header.size() || !checkFrameTable(header, extent))
+        return 0;
+
+    // Ends with whichever frame reaches furthest
+    return static_cast<uint32_t>(extent);
+}
+
+WavView::WavView(std::span<const std::byte> data)
+    : bytes(data) {
+    if (data.size() < 12 || !hasTag(data, 0, "RIFF") || !hasTag(data, 8, "WAVE"))
+        return;
+
+    // Chunks are a tag and a size, padded to an even length
+    size_t position = 12;
+    bool haveFormat = false;
+    while (data.size() - position >= 8) {
+        uint32_t chunkSize = readLE32(data, position + 4);
+        size_t body = position + 8;
+        size_t available = std::min<size_t>(chunkSize, data.size() - body);
+
+        if (hasTag(data, position, "fmt ") && available >= 16) {
+            format = readLE16(data, body);
+            channelCount = readLE16(data, body + 2);
+            rate = readLE32(data, body + 4);
+            sampleBits = readLE16(data, body + 14);
+            haveFormat = true;
+        }
+        else if (hasTag(data, position, "data")) {
+            sampleData = data.subspan(body, available);
+        }
+
+        if (available < chunkSize)
+            break;
+        position = std::min(data.size(), body + chunkSize + (chunkSize & 1));
+    }
+    valid = haveFormat;
+}
+
+size_t WavView::headerSize(std::span<const std::byte> /*available*/) {
+    return kHeaderSize;
+}
+
+uint32_t WavView::measure(std::span<const std::byte> header) {
+    if (header.size() < kHeaderSize)
+        return 0;
+
+    // The RIFF size counts everything after its own field, sizes that don't fit 32 bits aren't a real file
+    uint64_t size = static_cast<uint64_t>(readLE32(header, 4)) + kHeaderSize;
+    return size <= UINT32_MAX ? static_cast<uint32_t>(size) : 0;
+}
@@ -0,0 +1,389 @@
+// SignatureScanner.cpp : SIMD signature search used to find resource headers.
+//
+
+#include "headers/SignatureScanner.h"
+#include "headers/CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+static inline unsigned countTrailingZeros(uint32_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+size_t findCandidateScalar(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second) {
+    for (size_t i = 0; i < positions; ++i) {
+        if (static_cast<uint8_t>(buffer[i]) == first &&
+            static_cast<uint8_t>(buffer[i + secondOffset]) == second) {
+            return i;
+        }
+    }
+    return SIZE_MAX; // Not found
+}
+
+size_t findCandidateSSE2(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second) {
+#if defined(SANIT_HAVE_SSE2)
+    const __m128i firstVec = _mm_set1_epi8(static_cast<char>(first));
+    const __m128i secondVec = _mm_set1_epi8(static_cast<char>(second));
+
+    size_t i = 0;
+    for (; i + 16 <= positions; i += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i + secondOffset));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(a, firstVec), _mm_cmpeq_epi8(b, secondVec))));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    // Tail shorter than one block
+    size_t tail = findCandidateScalar(buffer + i, positions - i, first, secondOffset, second);
+    return tail == SIZE_MAX ? SIZE_MAX : i + tail;
+#else
+    return findCandidateScalar(buffer, positions, first, secondOffset, second);
+#endif
+}
+
+#if defined(SANIT_HAVE_AVX2)
+SANIT_TARGET_AVX2
+static size_t findCandidateAVX2Impl(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second) {
+    const __m256i firstVec = _mm256_set1_epi8(static_cast<char>(first));
+    const __m256i secondVec = _mm256_set1_epi8(static_cast<char>(second));
+
+    size_t i = 0;
+    for (; i + 32 <= positions; i += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i + secondOffset));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(a, firstVec), _mm256_cmpeq_epi8(b, secondVec))));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    size_t tail = findCandidateSSE2(buffer + i, positions - i, first, secondOffset, second);
+    return tail == SIZE_MAX ? SIZE_MAX : i + tail;
+}
+#endif
+
+size_t findCandidateAVX2(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second) {
+#if defined(SANIT_HAVE_AVX2)
+    if (cpuSupportsAVX2()) {
+        return findCandidateAVX2Impl(buffer, positions, first, secondOffset, second);
+    }
+#endif
+    return findCandidateSSE2(buffer, positions, first, secondOffset, second);
+}
+
+size_t findCandidate(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second) {
+    using CandidateKernel = size_t(*)(const char*, size_t, uint8_t, size_t, uint8_t);
+
+    static const CandidateKernel kernel = [] {
+#if defined(SANIT_HAVE_AVX2)
+        if (cpuSupportsAVX2())
+            return static_cast<CandidateKernel>(findCandidateAVX2Impl);
+#endif
+#if defined(SANIT_HAVE_SSE2)
+        return static_cast<CandidateKernel>(findCandidateSSE2);
+#else
+        return static_cast<CandidateKernel>(findCandidateScalar);
+#endif
+    }();
+
+    return kernel(buffer, positions, first, secondOffset, second);
+}
+
+size_t findAnyCandidateScalar(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount) {
+    for (size_t i = 0; i < positions; ++i) {
+        for (size_t a = 0; a < anchorCount; ++a) {
+            if (static_cast<uint8_t>(buffer[i]) == anchors[a].first &&
+                static_cast<uint8_t>(buffer[i + anchors[a].secondOffset]) == anchors[a].second) {
+                return i;
+            }
+        }
+    }
+    return SIZE_MAX; // Not found
+}
+
+size_t findAnyCandidateSSE2(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount) {
+#if defined(SANIT_HAVE_SSE2)
+    size_t i = 0;
+    for (; i + 16 <= positions; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i));
+        __m128i hits = _mm_setzero_si128();
+        for (size_t a = 0; a < anchorCount; ++a) {
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + i + anchors[a].secondOffset));
+            hits = _mm_or_si128(hits, _mm_and_si128(
+                _mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(anchors[a].first))),
+                _mm_cmpeq_epi8(second, _mm_set1_epi8(static_cast<char>(anchors[a].second)))));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    size_t tail = findAnyCandidateScalar(buffer + i, positions - i, anchors, anchorCount);
+    return tail == SIZE_MAX ? SIZE_MAX : i + tail;
+#else
+    return findAnyCandidateScalar(buffer, positions, anchors, anchorCount);
+#endif
+}
+
+#if defined(SANIT_HAVE_AVX2)
+SANIT_TARGET_AVX2
+static size_t findAnyCandidateAVX2Impl(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount) {
+    size_t i = 0;
+    for (; i + 32 <= positions; i += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i));
+        __m256i hits = _mm256_setzero_si256();
+        for (size_t a = 0; a < anchorCount; ++a) {
+            __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buffer + i + anchors[a].secondOffset));
+            hits = _mm256_or_si256(hits, _mm256_and_si256(
+                _mm256_cmpeq_epi8(block, _mm256_set1_epi8(static_cast<char>(anchors[a].first))),
+                _mm256_cmpeq_epi8(second, _mm256_set1_epi8(static_cast<char>(anchors[a].second)))));
+        }
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        if (mask != 0) {
+            return i + countTrailingZeros(mask);
+        }
+    }
+
+    size_t tail = findAnyCandidateSSE2(buffer + i, positions - i, anchors, anchorCount);
+    return tail == SIZE_MAX ? SIZE_MAX : i + tail;
+}
+#endif
+
+size_t findAnyCandidateAVX2(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount) {
+#if defined(SANIT_HAVE_AVX2)
+    if (cpuSupportsAVX2()) {
+        return findAnyCandidateAVX2Impl(buffer, positions, anchors, anchorCount);
+    }
+#endif
+    return findAnyCandidateSSE2(buffer, positions, anchors, anchorCount);
+}
+
+size_t findAnyCandidate(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount) {
+    using AnyCandidateKernel = size_t(*)(const char*, size_t, const ScanAnchor*, size_t);
+
+    static const AnyCandidateKernel kernel = [] {
+#if defined(SANIT_HAVE_AVX2)
+        if (cpuSupportsAVX2())
+            return static_cast<AnyCandidateKernel>(findAnyCandidateAVX2Impl);
+#endif
+#if defined(SANIT_HAVE_SSE2)
+        return static_cast<AnyCandidateKernel>(findAnyCandidateSSE2);
+#else
+        return static_cast<AnyCandidateKernel>(findAnyCandidateScalar);
+#endif
+    }();
+
+    return kernel(buffer, positions, anchors, anchorCount);
+}
+
+SignatureSet buildSignatureSet(const std::vector<SignaturePattern>& patterns) {
+    SignatureSet set;
+    set.patterns = patterns;
+
+    for (size_t i = 0; i < patterns.size() && i < 32; ++i) {
+        set.anchors.push_back(patterns[i].anchor);
+        set.firstByteDispatch[patterns[i].anchor.first] |= (1u << i);
+        set.maxLength = std::max({ set.maxLength, patterns[i].length, size_t(patterns[i].anchor.secondOffset) + 1 });
+    }
+
+    return set;
+}
+
+// Checks the patterns dispatched by the byte at position, returns the first one that matches
+static bool matchAt(const SignatureSet& set, const char* buffer, size_t bufferSize, size_t position, size_t& patternIndex) {
+    uint32_t candidates = set.firstByteDispatch[static_cast<uint8_t>(buffer[position])];
+    while (candidates != 0) {
+        size_t index = countTrailingZeros(candidates);
+        candidates &= candidates - 1;
+
+        const SignaturePattern& pattern = set.patterns[index];
+        if (matchesSignature(pattern, buffer + position, bufferSize - position)) {
+            patternIndex = index;
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t findNextSignature(const SignatureSet& set, const char* buffer, size_t bufferSize, size_t& patternIndex) {
+    if (set.anchors.empty())
+        return SIZE_MAX;
+
+    // Every anchor load stays inside the buffer for these positions
+    const size_t positions = bufferSize >= set.maxLength ? bufferSize - set.maxLength + 1 : 0;
+
+    size_t i = 0;
+    while (i < positions) {
+        size_t candidate = findAnyCandidate(buffer + i, positions - i, set.anchors.data(), set.anchors.size());
+        if (candidate == SIZE_MAX)
+            break;
+
+        i += candidate;
+        if (matchAt(set, buffer, bufferSize, i, patternIndex))
+            return i;
+        ++i;
+    }
+
+    // Tail where only the shorter signatures can still fit
+    for (i = positions; i < bufferSize; ++i) {
+        if (matchAt(set, buffer, bufferSize, i, patternIndex))
+            return i;
+    }
+    return SIZE_MAX; // Not found
+}
+
+// Collects the hits starting in [chunkStart, chunkEnd)
+static void findSignaturesInChunk(const SignatureSet& set, const char* buffer, size_t bufferSize,
+    size_t chunkStart, size_t chunkEnd, std::vector<SignatureHit>& hits) {
+    size_t position = chunkStart;
+    while (position < chunkEnd) {
+        // Let the scan see maxLength - 1 bytes past the chunk so boundary signatures still match
+        size_t available = std::min(bufferSize - position, chunkEnd - position + set.maxLength - 1);
+
+        size_t patternIndex = 0;
+        size_t offset = findNextSignature(set, buffer + position, available, patternIndex);
+        if (offset == SIZE_MAX || position + offset >= chunkEnd)
+            break;
+
+        hits.push_back({ position + offset, patternIndex });
+        position += offset + 1;
+    }
+}
+
+std::vector<SignatureHit> findAllSignatures(const SignatureSet& set, const char* buffer, size_t bufferSize, unsigned threadCount) {
+    if (threadCount == 0)
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    // Small buffers aren't worth the thread startup
+    const size_t minChunkSize = size_t(1) << 20;
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, bufferSize / minChunkSize));
+    size_t chunkSize = (bufferSize + chunkCount - 1) / chunkCount;
+
+    std::vector<std::vector<SignatureHit>> chunkHits(chunkCount);
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunkCount; ++i) {
+        size_t chunkStart = i * chunkSize;
+        size_t chunkEnd = std::min(bufferSize, chunkStart + chunkSize);
+        workers.emplace_back(findSignaturesInChunk, std::cref(set), buffer, bufferSize, chunkStart, chunkEnd, std::ref(chunkHits[i]));
+    }
+    // The calling thread takes the first chunk
+    findSignaturesInChunk(set, buffer, bufferSize, 0, std::min(bufferSize, chunkSize), chunkHits[0]);
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    // Chunks are in order, so concatenating keeps the hits sorted
+    std::vector<SignatureHit> hits = std::move(chunkHits[0]);
+    for (size_t i = 1; i < chunkCount; ++i) {
+        hits.insert(hits.end(), chunkHits[i].begin(), chunkHits[i].end());
+    }
+    return hits;
+}
+
+bool matchesSignature(const SignaturePattern& pattern, const char* data, size_t available) {
+    if (available < pattern.length)
+        return false;
+
+#if defined(SANIT_HAVE_SSE2)
+    // Whole signature in one masked compare, the unused tail of value and mask is zero
+    if (available >= kMaxSignatureLength) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.mask.data()));
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern.value.data()));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(bytes, mask), value)) == 0xFFFF;
+    }
+#endif
+
+    for (size_t i = 0; i < pattern.length; ++i) {
+        if ((static_cast<uint8_t>(data[i]) & pattern.mask[i]) != pattern.value[i])
+            return false;
+    }
+    return true;
+}
+
+size_t findSignature(const SignaturePattern& pattern, const char* buffer, size_t bufferSize) {
+    const ScanAnchor& anchor = pattern.anchor;
+    const size_t span = std::max(pattern.length, size_t(anchor.secondOffset) + 1);
+    if (pattern.length == 0 || bufferSize < span)
+        return SIZE_MAX;
+
+    // The two anchor bytes are the pre-filter, the rest is checked on candidates only
+    const size_t positions = bufferSize - span + 1;
+    size_t i = 0;
+    while (i < positions) {
+        size_t candidate = findCandidate(buffer + i, positions - i, anchor.first, anchor.secondOffset, anchor.second);
+        if (candidate == SIZE_MAX)
+            break;
+
+        i += candidate;
+        if (matchesSignature(pattern, buffer + i, bufferSize - i)) {
+            return i;
+        }
+        ++i;
+    }
+    return SIZE_MAX; // Not found
+}
+
+// Function to search for WAV header pattern
+size_t findWavHeader(const char* buffer, size_t bufferSize) {
+    // Look for the pattern RIFF____WAVEfmt  (where ____ is any 4 bytes)
+    return findSignature(kWavSignature, buffer, bufferSize);
+}
+
+size_t findGraphicsResourceHeader(const char* buffer, size_t bufferSize) {
+    // Signature is D3GR
+    return findSignature(kGraphicsResourceSignature, buffer, bufferSize);
+}
+
+size_t findWavHeaderScalar(const char* buffer, size_t bufferSize) {
+    if (bufferSize < 16)
+        return SIZE_MAX;
+
+    for (size_t i = 0; i <= bufferSize - 16; ++i) {
+        if ((unsigned char)buffer[i] == 0x52 && // 'R'
+            (unsigned char)buffer[i + 1] == 0x49 && // 'I'
+            (unsigned char)buffer[i + 2] == 0x46 && // 'F'
+            (unsigned char)buffer[i + 3] == 0x46 && // 'F'
+            // Skip size bytes (4-7)
+            (unsigned char)buffer[i + 8] == 0x57 && // 'W'
+            (unsigned char)buffer[i + 9] == 0x41 && // 'A'
+            (unsigned char)buffer[i + 10] == 0x56 && // 'V'
+            (unsigned char)buffer[i + 11] == 0x45 && // 'E'
+            (unsigned char)buffer[i + 12] == 0x66 && // 'f'
+            (unsigned char)buffer[i + 13] == 0x6D && // 'm'
+            (unsigned char)buffer[i + 14] == 0x74 && // 't'
+            (unsigned char)buffer[i + 15] == 0x20) { // ' '
+            return i;
+        }
+    }
+    return SIZE_MAX; // Not found
+}
+
+size_t findGraphicsResourceHeaderScalar(const char* buffer, size_t bufferSize) {
+    if (bufferSize < 4)
+        return SIZE_MAX;
+
+    for (size_t i = 0; i <= bufferSize - 4; ++i) {
+        if (buffer[i] == 'D' &&
+            buffer[i + 1] == '3' &&
+            buffer[i + 2] == 'G' &&
+            buffer[i + 3] == 'R') {
+            return i;
+        }
+    }
+    return SIZE_MAX; // Not found
+}
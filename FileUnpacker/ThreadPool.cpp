@@ -0,0 +1,164 @@
+// ThreadPool.cpp : Work stealing thread pool used for frame and resource extraction.
+//
+
+#include "headers/ThreadPool.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+// Queue of the pool worker running on this thread, SIZE_MAX on other threads
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local size_t currentQueue = SIZE_MAX;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (unsigned i = 0; i + 1 < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(TaskGroup& group, std::function<void()> task) {
+    group.pending.fetch_add(1);
+
+    bool onWorker = currentPool == this && currentQueue != SIZE_MAX;
+    Queue& queue = *queues[onWorker ? currentQueue : queues.size() - 1];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (onWorker) {
+            queue.tasks.push_front({ std::move(task), &group });
+        }
+        else {
+            queue.tasks.push_back({ std::move(task), &group });
+        }
+        group.queued.fetch_add(1);
+    }
+
+    bool waiters = false;
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        queuedTasks.fetch_add(1);
+        waiters = waitingThreads > 0;
+    }
+    // A waiting thread only takes tasks of its own group, it may be the one this task is for
+    if (waiters) {
+        wakeUp.notify_all();
+    }
+    else {
+        wakeUp.notify_one();
+    }
+}
+
+bool ThreadPool::popTask(size_t preferredQueue, TaskGroup* group, Task& task) {
+    if (group && group->queued.load() == 0)
+        return false;
+
+    // Own queue from the front (newest nested work), then steal the oldest task of the others
+    for (size_t i = 0; i < queues.size(); ++i) {
+        size_t index = (preferredQueue + i) % queues.size();
+        Queue& queue = *queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+
+        // The shared queue stays first in, first out so top level tasks start in submission order
+        std::deque<Task>::iterator found;
+        if (i == 0 || index == queues.size() - 1) {
+            found = std::find_if(queue.tasks.begin(), queue.tasks.end(), [&](const Task& queued) {
+                return !group || queued.group == group;
+                });
+        }
+        else {
+            auto last = std::find_if(queue.tasks.rbegin(), queue.tasks.rend(), [&](const Task& queued) {
+                return !group || queued.group == group;
+                });
+            found = last == queue.tasks.rend() ? queue.tasks.end() : std::prev(last.base());
+        }
+        if (found == queue.tasks.end())
+            continue;
+
+        task = std::move(*found);
+        queue.tasks.erase(found);
+        task.group->queued.fetch_sub(1);
+        queuedTasks.fetch_sub(1);
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runOne(size_t preferredQueue, TaskGroup* group) {
+    Task task;
+    if (!popTask(preferredQueue, group, task))
+        return false;
+
+    task.run();
+
+    // The waiter may destroy the group as soon as the count drops, it isn't touched after the decrement
+    const size_t waitLimit = task.group->waitLimit.load();
+    if (task.group->pending.fetch_sub(1) - 1 <= waitLimit) {
+        // Few enough tasks left, wake whoever waits for the group
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeUp.notify_all();
+    }
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentQueue = index;
+
+    while (true) {
+        if (runOne(index))
+            continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [&] { return stopping || queuedTasks.load() > 0; });
+        if (stopping && queuedTasks.load() == 0)
+            return;
+    }
+}
+
+void ThreadPool::wait(TaskGroup& group, size_t maxPending) {
+    size_t preferredQueue = currentPool == this && currentQueue != SIZE_MAX ? currentQueue : queues.size() - 1;
+    group.waitLimit = maxPending;
+
+    while (group.pending.load() > maxPending) {
+        if (runOne(preferredQueue, &group))
+            continue;
+
+        // Nothing left to help with, the remaining tasks are running on other threads
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        ++waitingThreads;
+        wakeUp.wait(lock, [&] { return group.pending.load() <= maxPending || group.queued.load() > 0; });
+        --waitingThreads;
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body) {
+    chunkSize = std::max<size_t>(chunkSize, 1);
+
+    TaskGroup group;
+    for (size_t begin = 0; begin < count; begin += chunkSize) {
+        size_t end = std::min(count, begin + chunkSize);
+        submit(group, [&body, begin, end] { body(begin, end); });
+    }
+    wait(group);
+}
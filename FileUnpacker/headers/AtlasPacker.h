@@ -0,0 +1,39 @@
+#ifndef ATLAS_PACKER_H
+#define ATLAS_PACKER_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @struct AtlasRect
+ * @brief Size of one rectangle to pack, and where it ended up
+ */
+struct AtlasRect {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t page = 0;
+};
+
+/**
+ * @struct AtlasPage
+ * @brief Size of one atlas page, cropped to the rectangles placed on it
+ */
+struct AtlasPage {
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * @brief Packs rectangles into as few pages as possible with MaxRects (best short side fit, no rotation)
+ *
+ * Every page is kept close to square and only grows up to maxPageSize on each side, the
+ * rectangles that don't fit go on the next page. Empty rectangles are placed at 0, 0 of page 0.
+ *
+ * @param rects Sizes in, positions and pages out
+ * @return false if a rectangle is larger than maxPageSize
+ */
+bool packAtlas(std::vector<AtlasRect>& rects, uint32_t maxPageSize, std::vector<AtlasPage>& pages);
+
+#endif // ATLAS_PACKER_H
@@ -0,0 +1,62 @@
+#ifndef CPU_FEATURES_H
+#define CPU_FEATURES_H
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SANIT_ARCH_X86 1
+#endif
+
+// SSE2 is part of the x86-64 baseline, 32-bit builds only get it when the compiler is told so
+#if defined(SANIT_ARCH_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SANIT_HAVE_SSE2 1
+#endif
+
+// AVX2 kernels are compiled in regardless of the global flags and only picked at runtime
+#if defined(SANIT_ARCH_X86)
+#if defined(__GNUC__) || defined(__clang__)
+#define SANIT_HAVE_AVX2 1
+#define SANIT_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#define SANIT_HAVE_AVX2 1
+#define SANIT_TARGET_AVX2
+#endif
+#endif
+
+#if defined(SANIT_ARCH_X86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Checks once whether the CPU and OS support AVX2
+ * @return true if AVX2 kernels can be used on this machine
+ */
+inline bool cpuSupportsAVX2() {
+#if defined(SANIT_HAVE_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#elif defined(SANIT_HAVE_AVX2) && defined(_MSC_VER)
+    static const bool supported = [] {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        // OSXSAVE and AVX, then make sure the OS saves the YMM registers
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#else
+    return false;
+#endif
+}
+
+#endif // CPU_FEATURES_H
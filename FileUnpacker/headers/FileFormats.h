@@ -1,26 +1,27 @@
 #ifndef FILE_FORMATS_H
 #define FILE_FORMATS_H
 
-#include <string>
-#include <vector>
-#include <regex>
+#include <array>
+#include <string_view>
 
 /**
- * @struct FileFormat
+ * @struct FileSignature
  * @brief Represents metadata about a file format
  */
-struct FileFormat {
-    std::string format;        // Format identifier (e.g., "WAV")
-    std::string description;   // Human-readable description
-    std::string extension;     // File extension including dot
-    std::string header_bytes;  // Hexadecimal representation of header bytes
+struct FileSignature {
+    std::string_view format;        // Format identifier (e.g., "WAV")
+    std::string_view description;   // Human-readable description
+    std::string_view extension;     // File extension including dot
+    std::string_view header_bytes;  // Hexadecimal representation of header bytes, xx matches any byte
 };
 
 /**
  * @var kFileFormats
  * @brief Collection of known file formats with their detection information
+ *
+ * The header patterns are compiled into scan matchers at compile time (see compileSignature).
  */
-const std::vector<FileFormat> kFileFormats = {
+constexpr std::array<FileSignature, 4> kFileFormats = {{
     // WAV Format
     {
         "WAV",
@@ -29,6 +30,14 @@ const std::vector<FileFormat> kFileFormats = {
         "52 49 46 46 xx xx xx xx 57 41 56 45 66 6D 74 20"
     },
 
+    // D3GR Format
+    {
+        "D3GR",
+        "Sanitarium Graphic Resource File",
+        ".d3gr",
+        "44 33 47 52"
+    },
+
     // JPEG-2000 Format
     {
         "JP2",
@@ -44,6 +53,17 @@ const std::vector<FileFormat> kFileFormats = {
         ".bmp",
         "42 4D"
     }
-};
+}};
+
+/**
+ * @brief Header pattern of a format in kFileFormats, empty if the format isn't listed
+ */
+constexpr std::string_view fileSignatureBytes(std::string_view format) {
+    for (const FileSignature& signature : kFileFormats) {
+        if (signature.format == format)
+            return signature.header_bytes;
+    }
+    return {};
+}
 
-#endif // FILE_FORMATS_H
\ No newline at end of file
+#endif // FILE_FORMATS_H
@@ -0,0 +1,101 @@
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class FrameStore
+ * @brief Content addressed record of the frame files written so far
+ *
+ * Frames are keyed by a hash of everything that ends up in the file (indices, size,
+ * palette, bitmap mode), so a frame seen before can be linked to the earlier file
+ * instead of being converted and written again. One store can be shared by several
+ * extraction runs to find duplicates across archives. All members are thread safe.
+ *
+ * Frames are decoded in parallel, so the frame that claims a content first is whichever
+ * gets there first. It converts the frame, but the file is written under the lowest
+ * ranked path claimed by then and every other path is linked to it. Which frame counts
+ * as the copy and which as a link (isCanonical) only depends on the ranks.
+ */
+class FrameStore {
+public:
+    enum class Claim {
+        Write,      // First frame with this content: convert it, then publish it
+        Link,       // Already written, link the frame's path to target
+        Joined,     // Being converted by another frame, which links the path once it's written
+    };
+
+    /**
+     * @brief Orders frames by archive (in the order they're extracted), resource and frame
+     */
+    static uint64_t rank(uint32_t archive, uint32_t resource, uint16_t frame);
+
+    /**
+     * @brief Numbers count archives after the ones extracted before, returns the number of the first
+     */
+    uint32_t reserveArchives(uint32_t count);
+
+    /**
+     * @brief Registers the frame at path as having the content of key
+     *
+     * Whatever content path held before is forgotten, so a rewritten file is never linked for its old content.
+     *
+     * @param target Set to the file to link to when the result is Claim::Link
+     */
+    Claim claim(uint64_t key, uint64_t rank, const std::string& path, std::string& target);
+
+    /**
+     * @brief Path the converted frame of key gets written to, by the frame that got Claim::Write for path
+     */
+    std::string beginPublish(uint64_t key, const std::string& path);
+
+    /**
+     * @brief Called once the file from beginPublish is written (or submitted to the writer)
+     * @return Paths that joined meanwhile and have to be linked to it, or written themselves if it failed
+     */
+    std::vector<std::string> finishPublish(uint64_t key, const std::string& written, bool success);
+
+    /**
+     * @brief Whether the frame at rank is the lowest ranked one claimed with the content of key
+     */
+    bool isCanonical(uint64_t key, uint64_t rank) const;
+
+    void countDuplicate();
+    size_t duplicates() const;
+
+private:
+    struct Group {
+        uint64_t rank = 0;                  // Lowest rank claimed so far
+        std::string path;                   // Its path
+        std::string written;                // Path holding the content, set once publishing starts
+        bool published = false;
+        std::vector<std::string> members;   // Paths waiting for the content to be written
+    };
+
+    // Drops the content path held before, unless it's key
+    void forget(const std::string& path, uint64_t key);
+
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, Group> files;          // Frames of each content
+    std::unordered_map<std::string, uint64_t> contents; // Content of every claimed path
+    size_t duplicateCount = 0;
+    uint32_t archiveCount = 0;
+};
+
+/**
+ * @brief Makes path a hard link to existing, or a copy of it where links aren't supported
+ * @return false if neither worked, path doesn't exist then
+ */
+bool linkOutputFile(const std::string& existing, const std::string& path);
+
+/**
+ * @brief Removes path before it's rewritten, so the data of files linked to it stays untouched
+ */
+void detachOutputFile(const std::string& path);
+
+#endif // FRAME_STORE_H
@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief 64-bit xxHash (XXH64) of a block of memory
+ *
+ * Fast non-cryptographic hash, used to detect changed archives and identical content.
+ */
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+#endif // HASH_H
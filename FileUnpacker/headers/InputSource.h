@@ -0,0 +1,58 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @class InputSource
+ * @brief Read-only view of a whole RES file
+ *
+ * The file is memory-mapped when the platform allows it, so the scanner and the
+ * D3GR parsers work straight on the page cache. If mapping fails the file is read
+ * into an owned buffer with a single read call instead.
+ */
+class InputSource {
+public:
+    InputSource() = default;
+    ~InputSource();
+
+    InputSource(const InputSource&) = delete;
+    InputSource& operator=(const InputSource&) = delete;
+
+    /**
+     * @brief Maps (or reads) the file, replacing anything opened before
+     * @return false if the file can't be opened or read
+     */
+    bool open(const std::string& filename);
+    void close();
+
+    const char* data() const { return fileData; }
+    size_t size() const { return fileSize; }
+    bool isMapped() const { return mapped; }
+
+    // Descriptor of the mapped file for copies done by the kernel (copy_file_range), -1 when there's none
+    int fileDescriptor() const { return fd; }
+
+    // Access pattern hints for the kernel, no-ops when the file isn't mapped
+    void adviseSequential() const;
+    void adviseWillNeed(size_t offset, size_t length) const;
+
+private:
+    bool openMapped(const std::string& filename);
+    bool openBuffered(const std::string& filename);
+
+    const char* fileData = nullptr;
+    size_t fileSize = 0;
+    bool mapped = false;
+    std::vector<char> buffer;   // Fallback storage when the file isn't mapped
+    int fd = -1;                // Kept open next to the mapping on POSIX systems
+
+#if defined(_WIN32)
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+#endif // INPUT_SOURCE_H
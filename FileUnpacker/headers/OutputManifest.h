@@ -0,0 +1,70 @@
+#ifndef OUTPUT_MANIFEST_H
+#define OUTPUT_MANIFEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct ManifestOutput
+ * @brief A file written for a resource, with its size when the run finished
+ */
+struct ManifestOutput {
+    std::string path;
+    uint64_t size;
+};
+
+/**
+ * @struct ManifestEntry
+ * @brief What a resource was extracted from and into
+ *
+ * The outputs are current as long as the resource has the same content, the palette and
+ * the output settings haven't changed and every output still has its recorded size.
+ */
+struct ManifestEntry {
+    uint32_t resourceIndex;
+    uint64_t offset;            // Position in the archive
+    uint32_t size;
+    uint64_t resourceHash;      // XXH64 of the resource
+    uint64_t paletteHash;       // 0 for formats that don't use the palette
+    uint64_t settingsHash;      // Output mode (frames, spritesheet, bitmap mode, trim, raw copy)
+    uint32_t frameCount;        // Frames extracted, counted again when the resource is skipped
+    std::vector<ManifestOutput> outputs;
+};
+
+/**
+ * @struct OutputManifest
+ * @brief Record of the outputs of one archive in one output folder, stored as a binary file in that folder
+ *
+ * The archive size and modification time identify the archive. While they match, resources
+ * are recognized by their position, otherwise their content is hashed and compared.
+ */
+struct OutputManifest {
+    uint64_t archiveSize = 0;
+    int64_t archiveModified = 0;
+    std::vector<ManifestEntry> entries;     // Ordered by resourceIndex
+};
+
+std::string outputManifestPath(const std::string& outputFolder);
+
+bool writeOutputManifest(const std::string& manifestPath, const OutputManifest& manifest);
+bool readOutputManifest(const std::string& manifestPath, OutputManifest& manifest);
+
+/**
+ * @brief Entry of a resource, null if the manifest has none
+ */
+const ManifestEntry* findManifestEntry(const OutputManifest& manifest, uint32_t resourceIndex);
+
+/**
+ * @brief Checks that every output of an entry exists with its recorded size
+ */
+bool areManifestOutputsCurrent(const ManifestEntry& entry);
+
+/**
+ * @brief Records paths as the outputs of entry, with their current sizes
+ * @return false if one of them doesn't exist, the entry mustn't be kept then
+ */
+bool recordManifestOutputs(ManifestEntry& entry, const std::vector<std::string>& paths);
+
+#endif // OUTPUT_MANIFEST_H
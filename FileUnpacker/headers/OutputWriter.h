@@ -0,0 +1,177 @@
+#ifndef OUTPUT_WRITER_H
+#define OUTPUT_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "PackFile.h"
+#include "Pipeline.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SANIT_HAVE_IO_URING 1
+#endif
+#endif
+
+/**
+ * @brief Writes a whole file, replacing what was there
+ *
+ * The old file is removed first rather than truncated, so files hard linked to it keep their content.
+ */
+bool writeOutputFile(const std::string& path, const void* data, size_t size);
+
+/**
+ * @brief Writes size bytes found at sourceOffset of the open file sourceFd as a whole file
+ *
+ * The kernel copies the range itself (copy_file_range, which shares the blocks instead on filesystems
+ * with reflinks), nothing goes through user memory. data holds the same bytes and is written instead
+ * wherever the kernel can't copy: no descriptor, another platform, or a filesystem refusing the copy.
+ */
+bool copyOutputFile(const std::string& path, int sourceFd, uint64_t sourceOffset, const void* data, size_t size);
+
+/**
+ * @class OutputWriter
+ * @brief Writes finished output files in the background
+ *
+ * Extraction hands over complete buffers and carries on, the files are written by an
+ * io_uring ring on Linux (several writes submitted per system call) or else by a few
+ * writer threads. Buffers waiting to be written are limited to memoryLimit bytes,
+ * submit blocks until there's room again so a slow disk can't make memory grow.
+ *
+ * A writer opened on a pack puts every file into that one pack instead, under its path,
+ * links becoming index entries that share the content of their source.
+ */
+class OutputWriter {
+public:
+    enum class Backend {
+        Threads,
+        IoUring,
+        Pack
+    };
+
+    /**
+     * @param threadCount Writer threads of the fallback backend
+     * @param memoryLimit Bytes of owned buffers allowed to wait for the disk
+     * @param useIoUring Try io_uring first, the threads are used if the kernel refuses it
+     */
+    explicit OutputWriter(unsigned threadCount = 2, size_t memoryLimit = size_t(64) << 20, bool useIoUring = true);
+
+    /**
+     * @brief Writer storing every file in the pack at packPath, which is finished when the writer is destroyed
+     */
+    explicit OutputWriter(const std::string& packPath, size_t memoryLimit = size_t(64) << 20);
+
+    /**
+     * @brief Writer handing its files to shared, for one of several runs sharing it
+     *
+     * flush waits only for the files submitted through this writer and reports only their failures,
+     * links still wait for files submitted through any writer of shared. shared has to outlive it.
+     */
+    explicit OutputWriter(OutputWriter& shared);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    Backend backend() const { return activeBackend; }
+
+    // false when the pack couldn't be created
+    bool isOpen() const { return activeBackend != Backend::Pack || pack.isOpen(); }
+
+    void submit(const std::string& path, std::vector<uint8_t> buffer);
+
+    /**
+     * @brief Writes data without copying it, the caller keeps it valid until flush returns (e.g. a mapped archive)
+     */
+    void submitView(const std::string& path, const void* data, size_t size);
+
+    /**
+     * @brief Writes a range of an open file with copyOutputFile, data and sourceFd stay valid until flush returns
+     *
+     * Packs get data like any other file.
+     */
+    void submitRange(const std::string& path, int sourceFd, uint64_t sourceOffset, const void* data, size_t size);
+
+    /**
+     * @brief Makes path a hard link to existing (or a copy of it), once everything submitted for existing is written
+     */
+    void submitLink(const std::string& existing, const std::string& path);
+
+    /**
+     * @brief Adds buffer to the end of path, after everything submitted for path before
+     *
+     * For files written in pieces (resources copied through the streaming window), the first piece goes through submit.
+     */
+    void submitAppend(const std::string& path, std::vector<uint8_t> buffer);
+
+    /**
+     * @brief Waits until every file submitted through this writer is written
+     * @return false if one of them failed since the last flush
+     */
+    bool flush();
+
+    /**
+     * @brief Time the writer spent writing (busy) and waiting for files (starved), and the files it finished
+     *
+     * The writer is the last stage of the extraction pipeline, these totals cover every run it served.
+     */
+    StageStats stats() const;
+
+private:
+    struct Job {
+        std::string path;
+        std::vector<uint8_t> buffer;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        std::string linkSource;     // Set for links
+        int sourceFd = -1;          // Set for ranges copied out of a file, data is the fallback
+        uint64_t sourceOffset = 0;
+        bool append = false;
+        OutputWriter* owner = nullptr;  // Writer the job was submitted through
+    };
+
+    void enqueue(Job job);
+    bool takeJob(Job& job, bool wait);
+    void finishJob(const Job& job, bool success);
+    void recordBusy(uint64_t nanos);
+    bool runJob(const Job& job);
+
+    void threadLoop();
+#if defined(SANIT_HAVE_IO_URING)
+    struct Ring;
+    bool startRing();
+    void ringLoop();
+    std::unique_ptr<Ring> ring;
+#endif
+
+    Backend activeBackend = Backend::Threads;
+    PackWriter pack;                    // Only touched by the single pack thread
+    size_t memoryLimit;
+
+    mutable std::mutex mutex;
+    std::condition_variable jobReady;   // Jobs queued or stopping
+    std::condition_variable roomFreed;  // Buffer memory released or a job finished
+    std::deque<Job> jobs;
+    std::unordered_map<std::string, size_t> pendingWrites;             // Unfinished writes per path
+    std::unordered_map<std::string, std::vector<Job>> waitingJobs;     // Links waiting for their source, appends for their file
+    size_t queuedBytes = 0;
+    OutputWriter* target = this;        // Writer running the jobs, the shared one for a writer made from it
+
+    // Jobs submitted through this writer, guarded by the mutex of target
+    size_t unfinishedJobs = 0;
+    bool failed = false;                // Since the last flush
+    bool stopping = false;
+    StageStats writeStats;
+
+    std::vector<std::thread> threads;
+};
+
+#endif // OUTPUT_WRITER_H
@@ -0,0 +1,91 @@
+#ifndef PACK_FILE_H
+#define PACK_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "InputSource.h"
+
+/**
+ * @struct PackEntry
+ * @brief One file stored in a pack, name being the path it would have on disk
+ */
+struct PackEntry {
+    std::string name;
+    uint64_t offset = 0;    // Position of the content in the pack
+    uint64_t size = 0;
+};
+
+/**
+ * @class PackWriter
+ * @brief Writes extracted files back to back into one pack file, followed by an index of them
+ *
+ * The whole run is a single sequential file, no directories and no per-file open or close.
+ * Entries that are the same as an earlier one (duplicate frames) only get an index entry
+ * pointing at the earlier content.
+ */
+class PackWriter {
+public:
+    PackWriter() = default;
+    ~PackWriter();
+
+    PackWriter(const PackWriter&) = delete;
+    PackWriter& operator=(const PackWriter&) = delete;
+
+    bool open(const std::string& path);
+
+    bool add(const std::string& name, const void* data, size_t size);
+
+    /**
+     * @brief Adds to the content of name when it's the last entry written, else starts a new entry
+     */
+    bool append(const std::string& name, const void* data, size_t size);
+
+    /**
+     * @brief Makes name share the content of existing
+     * @return false if existing isn't in the pack
+     */
+    bool alias(const std::string& existing, const std::string& name);
+
+    /**
+     * @brief Writes the index, the pack can't be read before this
+     */
+    bool close();
+
+    bool isOpen() const { return file.is_open(); }
+
+private:
+    std::ofstream file;
+    uint64_t position = 0;
+    std::vector<PackEntry> entries;
+    std::unordered_map<std::string, size_t> lookup;   // Latest entry of every name
+};
+
+/**
+ * @class PackReader
+ * @brief Maps a pack and finds its entries by name
+ */
+class PackReader {
+public:
+    bool open(const std::string& path);
+
+    const std::vector<PackEntry>& entries() const { return packEntries; }
+
+    /**
+     * @brief Entry stored under name, the last one if it was added more than once, null if there's none
+     */
+    const PackEntry* find(const std::string& name) const;
+
+    const char* data(const PackEntry& entry) const { return input.data() + entry.offset; }
+
+private:
+    InputSource input;
+    std::vector<PackEntry> packEntries;
+    std::unordered_map<std::string, size_t> lookup;
+};
+
+#endif // PACK_FILE_H
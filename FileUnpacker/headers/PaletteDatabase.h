@@ -0,0 +1,74 @@
+#ifndef PALETTE_DATABASE_H
+#define PALETTE_DATABASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "InputSource.h"
+
+// Bytes of one palette: 256 colors as R, G, B
+constexpr size_t kPaletteSize = 256 * 3;
+
+/**
+ * @struct PaletteMapping
+ * @brief Palette used for the frames of one RES file
+ */
+struct PaletteMapping {
+    std::string archiveName;    // File name of the archive, e.g. RES.006
+    uint32_t paletteIndex;
+};
+
+/**
+ * @class PaletteDatabase
+ * @brief Palettes of the game worlds and which RES file uses which, mapped from a binary file
+ *
+ * Palettes and mappings are fixed size records, so opening the file is a mapping and a size
+ * check whatever the number of palettes, and every palette handed out points into the mapping.
+ * It stays valid as long as the database is open.
+ */
+class PaletteDatabase {
+public:
+    bool open(const std::string& path);
+    bool isOpen() const { return input.data() != nullptr; }
+
+    size_t paletteCount() const { return palettes; }
+
+    /**
+     * @brief Palette number index, empty if there's no such palette
+     */
+    std::span<const uint8_t> palette(size_t index) const;
+
+    /**
+     * @brief Palette of an archive by file name, empty if the archive isn't mapped
+     */
+    std::span<const uint8_t> paletteFor(std::string_view archiveName) const;
+
+    /**
+     * @brief Palette for archives that aren't mapped, empty if the database doesn't name one
+     */
+    std::span<const uint8_t> defaultPalette() const { return palette(defaultIndex); }
+    uint32_t defaultPaletteIndex() const { return defaultIndex; }
+
+    size_t mappingCount() const { return mappings; }
+    PaletteMapping mapping(size_t index) const;
+
+private:
+    InputSource input;
+    size_t palettes = 0;
+    size_t mappings = 0;
+    uint32_t defaultIndex = 0;
+};
+
+/**
+ * @brief Writes a palette database, replacing path only once the new one is complete
+ *
+ * Every palette must be kPaletteSize bytes and archive names at most 16 bytes long.
+ */
+bool writePaletteDatabase(const std::string& path, const std::vector<std::vector<uint8_t>>& palettes, std::vector<PaletteMapping> mappings,
+    uint32_t defaultPaletteIndex);
+
+#endif // PALETTE_DATABASE_H
@@ -0,0 +1,112 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+
+#include "ThreadPool.h"
+
+/**
+ * @struct StageStats
+ * @brief Where a pipeline stage spent its time, summed over the threads that worked on it
+ */
+struct StageStats {
+    unsigned threads = 0;
+    uint64_t busyNanos = 0;     // Working on items
+    uint64_t starvedNanos = 0;  // Waiting for input
+    uint64_t queuedNanos = 0;   // Items waiting for a thread to start them
+    uint64_t blockedNanos = 0;  // Held back until the next stages caught up
+    uint64_t items = 0;         // Items taken from the input
+
+    StageStats& operator+=(const StageStats& other);
+};
+
+inline uint64_t pipelineNanosSince(std::chrono::steady_clock::time_point start) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+/**
+ * @class PipelineStage
+ * @brief One stage of a pipeline whose work runs as tasks on a ThreadPool
+ *
+ * A stage has no threads of its own, its tasks share the pool with the other stages and every
+ * item is timed on whichever thread runs it. maxTasks caps how many of the stage's tasks run at
+ * once, the others wait in the stage until one finishes.
+ */
+class PipelineStage {
+public:
+    /**
+     * @param group Group the stage's tasks are part of, tasks waiting for the cap count as pending in it
+     * @param maxTasks Tasks of the stage running at once, 0 lets it use every thread of the pool
+     */
+    PipelineStage(std::string name, ThreadPool& pool, TaskGroup& group, unsigned maxTasks = 0);
+
+    PipelineStage(const PipelineStage&) = delete;
+    PipelineStage& operator=(const PipelineStage&) = delete;
+
+    const std::string& name() const { return stageName; }
+
+    /**
+     * @brief Runs body as a task of the stage once the cap allows it
+     * @param items Items the task handles, for the stats
+     */
+    void submit(std::function<void()> body, uint64_t items = 1);
+
+    /**
+     * @brief Runs body on the calling thread as one item of the stage, its time counts as busy
+     */
+    template <typename Body>
+    void run(Body&& body) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        record(pipelineNanosSince(start), 1);
+    }
+
+    // Adds work timed by the caller
+    void record(uint64_t busyNanos, uint64_t items);
+
+    // Time the stage was held back waiting for the stages after it
+    void recordBlocked(uint64_t nanos);
+
+    StageStats stats() const;
+
+private:
+    struct WaitingTask {
+        std::function<void()> body;
+        uint64_t items = 0;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    void launch(WaitingTask task);
+
+    std::string stageName;
+    ThreadPool& pool;
+    TaskGroup& group;
+    unsigned maxTasks;
+
+    std::mutex mutex;
+    std::deque<WaitingTask> waiting;    // Held back by the cap
+    unsigned runningTasks = 0;
+
+    std::atomic<uint64_t> busyNanos{ 0 };
+    std::atomic<uint64_t> queuedNanos{ 0 };
+    std::atomic<uint64_t> blockedNanos{ 0 };
+    std::atomic<uint64_t> items{ 0 };
+};
+
+/**
+ * @brief Prints one line per stage: threads, busy, waiting and blocked time and how busy the stage was over wallNanos
+ *
+ * Stages run as pool tasks (pooled) report how long their items were queued before a thread took
+ * them, the writer how long its threads were starved for files.
+ */
+void printStageStats(std::ostream& out, const std::string& name, const StageStats& stats, uint64_t wallNanos, bool pooled);
+
+#endif // PIPELINE_H
@@ -0,0 +1,70 @@
+#ifndef PIXEL_CONVERSION_H
+#define PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @struct PaletteLUT
+ * @brief 256 palette colors packed as little endian BGRA words
+ *
+ * Each entry is laid out in memory as B, G, R, 0xFF, which is the BMP byte order,
+ * so converting a pixel is one table load and no channel swapping.
+ */
+struct PaletteLUT {
+    alignas(32) uint32_t bgra[256];
+};
+
+/**
+ * @brief Packs an RGB palette (256 * 3 bytes, see PaletteDatabase) into a lookup table
+ *
+ * Missing entries (short or empty palettes) fall back to grayscale.
+ */
+PaletteLUT buildPaletteLUT(std::span<const uint8_t> palette);
+
+/**
+ * @brief Index of the palette color closest to r, g, b (squared distance, lowest index on ties)
+ */
+uint8_t findNearestPaletteIndex(const PaletteLUT& lut, uint8_t r, uint8_t g, uint8_t b);
+
+/**
+ * @brief Expands count palette indices into count * 3 bytes of BGR
+ *
+ * Uses an AVX2 gather/shuffle kernel when the CPU supports it.
+ */
+void convertIndicesToBGR(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out);
+
+// Individual kernels, exposed so they can be checked against each other
+void convertIndicesToBGRScalar(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out);
+void convertIndicesToBGRAVX2(const uint8_t* indices, size_t count, const PaletteLUT& lut, uint8_t* out);
+
+/**
+ * @struct FrameBounds
+ * @brief Rectangle of a frame, in pixels from its top left corner
+ */
+struct FrameBounds {
+    uint32_t x = 0;
+    uint32_t y = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/**
+ * @brief Smallest rectangle holding every pixel that isn't palette index 0 (the transparent background)
+ *
+ * Rows are checked 16 pixels at a time. Fully transparent frames give an empty (0 x 0) rectangle.
+ *
+ * @param indices width * height palette indices, top row first
+ */
+FrameBounds findOpaqueBounds(const uint8_t* indices, uint32_t width, uint32_t height);
+
+// Position of the first pixel that isn't index 0, count if there's none
+size_t findFirstOpaqueScalar(const uint8_t* indices, size_t count);
+size_t findFirstOpaqueSSE2(const uint8_t* indices, size_t count);
+// One past the last pixel that isn't index 0, 0 if there's none
+size_t findOpaqueEndScalar(const uint8_t* indices, size_t count);
+size_t findOpaqueEndSSE2(const uint8_t* indices, size_t count);
+
+#endif // PIXEL_CONVERSION_H
@@ -0,0 +1,73 @@
+#ifndef RESOURCE_INDEX_H
+#define RESOURCE_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @struct IndexedFrame
+ * @brief Location and size of one D3GR frame
+ */
+struct IndexedFrame {
+    uint32_t offset;    // Frame header position, relative to the start of its resource
+    uint16_t width;
+    uint16_t height;
+};
+
+/**
+ * @struct IndexedResource
+ * @brief One carved resource of an archive
+ */
+struct IndexedResource {
+    uint64_t offset;        // Absolute position in the archive
+    uint32_t size;
+    uint32_t firstFrame;    // Index of the first frame in ResourceIndex::frames
+    uint16_t frameCount;
+    uint8_t format;         // FileFormat value
+};
+
+/**
+ * @struct ResourceIndex
+ * @brief Table of contents of a RES file, stored as a binary sidecar next to it
+ *
+ * The archive size, modification time and hash tell whether the index still
+ * matches the archive. formatMask records which formats were scanned, since
+ * carving the same archive with another set of formats can give other results.
+ */
+struct ResourceIndex {
+    uint64_t archiveSize = 0;
+    int64_t archiveModified = 0;
+    uint64_t archiveHash = 0;
+    uint32_t formatMask = 0;
+    std::vector<IndexedResource> resources;
+    std::vector<IndexedFrame> frames;
+};
+
+/**
+ * @brief Path of the index sidecar for an archive
+ * @param formatsTag Names the scanned formats (e.g. "wav-d3gr"), each set of formats gets its own sidecar
+ */
+std::string resourceIndexPath(const std::string& archivePath, const std::string& formatsTag);
+
+/**
+ * @brief Modification time of a file as stored in the index, 0 if it can't be read
+ */
+int64_t fileModifiedTime(const std::string& path);
+
+bool writeResourceIndex(const std::string& indexPath, const ResourceIndex& index);
+bool readResourceIndex(const std::string& indexPath, ResourceIndex& index);
+
+/**
+ * @brief Checks an index against the archive it was built from
+ *
+ * Size and modification time are compared first. When only the modification time
+ * changed (the archive was copied or touched) the archive is hashed and the index
+ * is still accepted if the content is the same.
+ *
+ * @param data Archive content, only read when the hash has to be checked
+ */
+bool isResourceIndexCurrent(const ResourceIndex& index, const std::string& archivePath, const char* data, size_t size);
+
+#endif // RESOURCE_INDEX_H
@@ -0,0 +1,161 @@
+#ifndef RESOURCE_VIEWS_H
+#define RESOURCE_VIEWS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @brief Bytes of a buffer as a span, for the views below
+ */
+inline std::span<const std::byte> asBytes(const void* data, size_t size) {
+    return { static_cast<const std::byte*>(data), size };
+}
+
+/**
+ * @brief Little endian fields, offset + 2 (or 4) bytes must be inside data
+ */
+inline uint16_t readLE16(std::span<const std::byte> data, size_t offset) {
+    return static_cast<uint16_t>(std::to_integer<uint16_t>(data[offset]) | (std::to_integer<uint16_t>(data[offset + 1]) << 8));
+}
+
+inline uint32_t readLE32(std::span<const std::byte> data, size_t offset) {
+    return std::to_integer<uint32_t>(data[offset]) | (std::to_integer<uint32_t>(data[offset + 1]) << 8) |
+        (std::to_integer<uint32_t>(data[offset + 2]) << 16) | (std::to_integer<uint32_t>(data[offset + 3]) << 24);
+}
+
+/**
+ * @class FrameView
+ * @brief One frame of a D3GR resource, pointing into the resource's bytes
+ */
+class FrameView {
+public:
+    static constexpr size_t kHeaderSize = 0x10;         // The palette indices follow the header
+    static constexpr size_t kHeightOffset = 0x0C;
+    static constexpr size_t kWidthOffset = 0x0E;
+
+    FrameView() = default;
+    FrameView(uint32_t offset, uint16_t width, uint16_t height, std::span<const std::byte> pixels)
+        : headerOffset(offset), frameWidth(width), frameHeight(height), pixelData(pixels) {}
+
+    // Position of the frame header in its resource
+    uint32_t offset() const { return headerOffset; }
+    uint16_t width() const { return frameWidth; }
+    uint16_t height() const { return frameHeight; }
+
+    // width * height palette indices, rows top to bottom
+    std::span<const std::byte> pixels() const { return pixelData; }
+    const uint8_t* indices() const { return reinterpret_cast<const uint8_t*>(pixelData.data()); }
+
+private:
+    uint32_t headerOffset = 0;
+    uint16_t frameWidth = 0;
+    uint16_t frameHeight = 0;
+    std::span<const std::byte> pixelData;
+};
+
+/**
+ * @class D3GRView
+ * @brief Sanitarium graphic resource (D3GR) read in place
+ *
+ * The frame count is at 0x18, followed at 0x1C by a table of frame positions relative to the end
+ * of the table. Every frame is a 0x10 byte header holding its height and width, then its palette
+ * indices. The table is read once when the view is made, the frames point into the same bytes.
+ *
+ * The "D3GR" signature is short enough to turn up inside other data, so the table is checked before
+ * anything trusts it: at least one frame, frames in table order without overlapping, and no side
+ * larger than kMaxFrameDimension.
+ */
+class D3GRView {
+public:
+    static constexpr size_t kFrameCountOffset = 0x18;
+    static constexpr size_t kFrameTableOffset = 0x1C;
+    static constexpr uint16_t kMaxFrameDimension = 4096;
+
+    D3GRView() = default;
+
+    /**
+     * @brief Reads the frame table of the resource held by data
+     *
+     * The view is invalid (and has no frames) when the table isn't valid or one of the frames doesn't fit in data.
+     */
+    explicit D3GRView(std::span<const std::byte> data);
+
+    bool isValid() const { return valid; }
+    std::span<const std::byte> data() const { return bytes; }
+
+    size_t frameCount() const { return frameViews.size(); }
+    const FrameView& frame(size_t index) const { return frameViews[index]; }
+    const std::vector<FrameView>& frames() const { return frameViews; }
+
+    /**
+     * @brief Bytes measure reads from the start of a resource, more than available.size() while the frame table is incomplete
+     */
+    static size_t headerSize(std::span<const std::byte> available);
+
+    /**
+     * @brief Size of the resource starting at header, up to the end of the frame that reaches furthest
+     * @return 0 if header is shorter than headerSize or its frame table isn't valid
+     */
+    static uint32_t measure(std::span<const std::byte> header);
+
+private:
+    /**
+     * @brief Checks the frame table and every frame header, which must be in header
+     * @param extent Set to the end of the furthest frame, which may be past the end of header
+     */
+    static bool checkFrameTable(std::span<const std::byte> header, uint64_t& extent);
+
+    std::span<const std::byte> bytes;
+    std::vector<FrameView> frameViews;
+    bool valid = false;
+};
+
+/**
+ * @class WavView
+ * @brief RIFF WAVE file read in place
+ *
+ * Only the fmt and data chunks are looked at, everything else is skipped.
+ */
+class WavView {
+public:
+    static constexpr size_t kHeaderSize = 8;    // RIFF tag and the size of the rest
+
+    WavView() = default;
+
+    /**
+     * @brief Reads the chunks of the file held by data, invalid when it isn't a WAVE file or has no fmt chunk
+     */
+    explicit WavView(std::span<const std::byte> data);
+
+    bool isValid() const { return valid; }
+    std::span<const std::byte> data() const { return bytes; }
+
+    uint16_t audioFormat() const { return format; }     // 1 for PCM
+    uint16_t channels() const { return channelCount; }
+    uint32_t sampleRate() const { return rate; }
+    uint16_t bitsPerSample() const { return sampleBits; }
+
+    // Content of the data chunk, cut short when the file is
+    std::span<const std::byte> samples() const { return sampleData; }
+
+    static size_t headerSize(std::span<const std::byte> available);
+
+    /**
+     * @brief Size of the file from its RIFF header
+     * @return 0 if header is shorter than kHeaderSize or the size doesn't fit 32 bits
+     */
+    static uint32_t measure(std::span<const std::byte> header);
+
+private:
+    std::span<const std::byte> bytes;
+    std::span<const std::byte> sampleData;
+    uint16_t format = 0;
+    uint16_t channelCount = 0;
+    uint32_t rate = 0;
+    uint16_t sampleBits = 0;
+    bool valid = false;
+};
+
+#endif // RESOURCE_VIEWS_H
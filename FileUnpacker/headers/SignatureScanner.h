@@ -0,0 +1,201 @@
+#ifndef SIGNATURE_SCANNER_H
+#define SIGNATURE_SCANNER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "FileFormats.h"
+
+/**
+ * @struct ScanAnchor
+ * @brief Two bytes of a signature used by the SIMD pre-filter
+ */
+struct ScanAnchor {
+    uint8_t first;          // Signature byte at offset 0
+    uint8_t secondOffset;   // Offset of the second anchor byte
+    uint8_t second;         // Signature byte at secondOffset
+};
+
+// Longest signature a pattern can hold, one SSE register
+constexpr size_t kMaxSignatureLength = 16;
+
+/**
+ * @struct SignaturePattern
+ * @brief A header signature compiled to value/mask form
+ *
+ * A byte at offset i matches when (byte & mask[i]) == value[i]. Wildcards have a zero
+ * mask, and the unused tail of both arrays is zero so a full 16 byte compare works.
+ */
+struct SignaturePattern {
+    std::array<uint8_t, kMaxSignatureLength> value{};
+    std::array<uint8_t, kMaxSignatureLength> mask{};
+    size_t length = 0;      // Bytes needed to check the full signature, 0 if the pattern is invalid
+    ScanAnchor anchor{};
+};
+
+constexpr int hexDigitValue(char c) {
+    return (c >= '0' && c <= '9') ? c - '0' :
+        (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+        (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+}
+
+/**
+ * @brief Compiles a header pattern like "52 49 46 46 xx xx xx xx 57 41 56 45" into a matcher
+ *
+ * Runs at compile time when given a constant (see kFileFormats). Patterns that are malformed,
+ * longer than kMaxSignatureLength or start with a wildcard give a pattern of length 0.
+ */
+constexpr SignaturePattern compileSignature(std::string_view hexPattern) {
+    SignaturePattern pattern;
+    size_t length = 0;
+
+    for (size_t i = 0; i < hexPattern.size();) {
+        if (hexPattern[i] == ' ') {
+            ++i;
+            continue;
+        }
+        if (i + 1 >= hexPattern.size() || length == kMaxSignatureLength)
+            return SignaturePattern();
+
+        char high = hexPattern[i];
+        char low = hexPattern[i + 1];
+        if ((high == 'x' || high == 'X') && (low == 'x' || low == 'X')) {
+            pattern.value[length] = 0;
+            pattern.mask[length] = 0;
+        }
+        else {
+            if (hexDigitValue(high) < 0 || hexDigitValue(low) < 0)
+                return SignaturePattern();
+            pattern.value[length] = static_cast<uint8_t>(hexDigitValue(high) * 16 + hexDigitValue(low));
+            pattern.mask[length] = 0xFF;
+        }
+        ++length;
+        i += 2;
+    }
+
+    // The scanner looks for the first byte, so it can't be a wildcard
+    if (length == 0 || pattern.mask[0] != 0xFF)
+        return SignaturePattern();
+    pattern.length = length;
+
+    // Second anchor: the last fixed byte, skipping values that are everywhere in binary data when possible
+    pattern.anchor = { pattern.value[0], 0, pattern.value[0] };
+    bool anchorIsCommon = true;
+    for (size_t i = length; i-- > 1;) {
+        if (pattern.mask[i] != 0xFF)
+            continue;
+
+        bool common = pattern.value[i] == 0x00 || pattern.value[i] == 0x20 || pattern.value[i] == 0xFF;
+        if (pattern.anchor.secondOffset == 0 || (anchorIsCommon && !common)) {
+            pattern.anchor.secondOffset = static_cast<uint8_t>(i);
+            pattern.anchor.second = pattern.value[i];
+            anchorIsCommon = common;
+        }
+    }
+
+    return pattern;
+}
+
+// Header patterns of the carved formats, compiled from kFileFormats
+constexpr SignaturePattern kWavSignature = compileSignature(fileSignatureBytes("WAV"));
+constexpr SignaturePattern kGraphicsResourceSignature = compileSignature(fileSignatureBytes("D3GR"));
+static_assert(kWavSignature.length > 0, "Invalid WAV header pattern in kFileFormats");
+static_assert(kGraphicsResourceSignature.length > 0, "Invalid D3GR header pattern in kFileFormats");
+
+/**
+ * @struct SignatureSet
+ * @brief Several signatures compiled for a single scanning pass
+ */
+struct SignatureSet {
+    std::vector<SignaturePattern> patterns;
+    std::vector<ScanAnchor> anchors;
+    std::array<uint32_t, 256> firstByteDispatch{};  // Bit i is set if pattern i starts with this byte
+    size_t maxLength = 0;
+};
+
+/**
+ * @struct SignatureHit
+ * @brief Position of a matched signature and the pattern that matched there
+ */
+struct SignatureHit {
+    size_t offset;
+    size_t patternIndex;
+};
+
+/**
+ * @brief Finds the first position p in [0, positions) where buffer[p] == first
+ *        and buffer[p + secondOffset] == second
+ *
+ * This is the SIMD pre-filter used by the header finders: it checks 16 (SSE2) or
+ * 32 (AVX2) positions per step and only returns candidates, which still need a
+ * full signature compare. The buffer must be readable up to positions - 1 + secondOffset.
+ * The best kernel for the running CPU is picked on first use.
+ *
+ * @return Offset of the candidate, or SIZE_MAX if there is none
+ */
+size_t findCandidate(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second);
+
+/**
+ * @brief Same as findCandidate, but stops at the first position matching any of the anchors
+ *
+ * The buffer must be readable up to positions - 1 + the largest secondOffset.
+ */
+size_t findAnyCandidate(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount);
+
+// Individual kernels, exposed so they can be checked against each other
+size_t findCandidateScalar(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second);
+size_t findCandidateSSE2(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second);
+size_t findCandidateAVX2(const char* buffer, size_t positions, uint8_t first, size_t secondOffset, uint8_t second);
+
+size_t findAnyCandidateScalar(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount);
+size_t findAnyCandidateSSE2(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount);
+size_t findAnyCandidateAVX2(const char* buffer, size_t positions, const ScanAnchor* anchors, size_t anchorCount);
+
+/**
+ * @brief Full compare of a compiled signature, with one masked 16 byte compare when enough data is readable
+ * @return false if fewer than pattern.length bytes are available
+ */
+bool matchesSignature(const SignaturePattern& pattern, const char* data, size_t available);
+
+/**
+ * @brief Finds the first occurrence of a single compiled signature
+ * @return Offset of the header, or SIZE_MAX if not found
+ */
+size_t findSignature(const SignaturePattern& pattern, const char* buffer, size_t bufferSize);
+
+/**
+ * @brief Builds the anchor list and first byte dispatch table for a group of signatures
+ * @note At most 32 patterns are supported
+ */
+SignatureSet buildSignatureSet(const std::vector<SignaturePattern>& patterns);
+
+/**
+ * @brief Finds the first position where any signature of the set matches
+ * @param patternIndex Receives the index of the matching pattern
+ * @return Offset of the header, or SIZE_MAX if not found
+ */
+size_t findNextSignature(const SignatureSet& set, const char* buffer, size_t bufferSize, size_t& patternIndex);
+
+/**
+ * @brief Finds every position where a signature of the set matches, in increasing order
+ *
+ * The buffer is split into one chunk per thread and the chunks are scanned in parallel.
+ * Each chunk may read past its end so signatures crossing a boundary are kept.
+ * Each position reports the same pattern findNextSignature would.
+ *
+ * @param threadCount Number of scanning threads, 0 uses every hardware thread
+ */
+std::vector<SignatureHit> findAllSignatures(const SignatureSet& set, const char* buffer, size_t bufferSize, unsigned threadCount = 0);
+
+// Header finders, they return the offset of the first header or SIZE_MAX if not found
+size_t findWavHeader(const char* buffer, size_t bufferSize);
+size_t findGraphicsResourceHeader(const char* buffer, size_t bufferSize);
+
+// Byte by byte reference versions of the header finders
+size_t findWavHeaderScalar(const char* buffer, size_t bufferSize);
+size_t findGraphicsResourceHeaderScalar(const char* buffer, size_t bufferSize);
+
+#endif // SIGNATURE_SCANNER_H
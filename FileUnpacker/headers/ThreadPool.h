@@ -0,0 +1,93 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @struct TaskGroup
+ * @brief Set of tasks that can be waited for together
+ */
+struct TaskGroup {
+    std::atomic<size_t> pending{ 0 };
+    std::atomic<size_t> queued{ 0 };        // Pending tasks no thread has taken yet
+    std::atomic<size_t> waitLimit{ 0 };     // Pending count the thread waiting for the group wants to see
+};
+
+/**
+ * @class ThreadPool
+ * @brief Work stealing pool running extraction tasks
+ *
+ * Every worker has its own queue. Tasks submitted from a worker go to the front of that
+ * worker's queue, so nested work (the frames of a resource) runs first and stays on the
+ * same thread, and idle workers steal from the back of the other queues.
+ *
+ * Threads waiting for a group run its queued tasks meanwhile, which makes it safe to wait
+ * from inside a task. They only take tasks of that group, so a task waiting for its nested
+ * work never ends up running an unrelated top level task (another archive) on its stack.
+ * A pool of one thread has no workers at all, every task then runs on the thread that
+ * waits for it, in submission order.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threadCount Threads doing work including the one that waits, 0 uses every hardware thread
+     */
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned threadCount() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    void submit(TaskGroup& group, std::function<void()> task);
+
+    /**
+     * @brief Runs queued tasks of the group until at most maxPending of them are left, by default until all have finished
+     *
+     * A producer submitting tasks faster than the pool runs them waits with a limit, helping
+     * with the backlog instead of letting it grow. The group can only be destroyed once a wait
+     * without a limit has returned.
+     */
+    void wait(TaskGroup& group, size_t maxPending = 0);
+
+    /**
+     * @brief Calls body(begin, end) over [0, count) in chunks of up to chunkSize, and waits for all of them
+     */
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body);
+
+private:
+    struct Task {
+        std::function<void()> run;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(size_t index);
+    // Runs a queued task, only one of group when it's set
+    bool runOne(size_t preferredQueue, TaskGroup* group = nullptr);
+    bool popTask(size_t preferredQueue, TaskGroup* group, Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;   // One per worker, the last one takes tasks from other threads
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    std::atomic<size_t> queuedTasks{ 0 };
+    unsigned waitingThreads = 0;                 // Threads sleeping in wait, guarded by sleepMutex
+    bool stopping = false;
+};
+
+#endif // THREAD_POOL_H
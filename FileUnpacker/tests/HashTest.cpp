@@ -0,0 +1,79 @@
+// HashTest.cpp : Checks hashBytes against the reference XXH64 test vectors.
+//
+
+#include "Hash.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static int failures = 0;
+
+static void expectHash(const char* what, size_t size, uint64_t seed, uint64_t expected, uint64_t actual) {
+    if (expected == actual)
+        return;
+
+    ++failures;
+    std::cerr << what << " (" << size << " bytes, seed " << seed << "): expected " << std::hex << expected
+        << ", got " << actual << std::dec << std::endl;
+}
+
+static const uint64_t kPrime32 = 2654435761ULL;
+
+// The sanity buffer of the xxHash test suite
+static std::vector<uint8_t> sanityBuffer(size_t size) {
+    std::vector<uint8_t> buffer(size);
+    uint64_t generator = kPrime32;
+    for (uint8_t& byte : buffer) {
+        byte = static_cast<uint8_t>(generator >> 56);
+        generator *= 11400714785074694797ULL;
+    }
+    return buffer;
+}
+
+int main() {
+    struct Vector {
+        size_t size;
+        uint64_t seed;
+        uint64_t hash;
+    };
+
+    // Empty, single byte, tail only, exactly one stripe and several stripes plus a tail
+    static const Vector vectors[] = {
+        { 0, 0, 0xEF46DB3751D8E999ULL },
+        { 0, kPrime32, 0xAC75FDA2929B17EFULL },
+        { 1, 0, 0xE934A84ADB052768ULL },
+        { 1, kPrime32, 0x5014607643A9B4C3ULL },
+        { 4, 0, 0x9136A0DCA57457EEULL },
+        { 14, 0, 0x8282DCC4994E35C8ULL },
+        { 14, kPrime32, 0xC3BD6BF63DEB6DF0ULL },
+        { 32, 0, 0x18B216492BB44B70ULL },
+        { 32, kPrime32, 0xB3F33BDF93ADE409ULL },
+        { 222, 0, 0xB641AE8CB691C174ULL },
+        { 222, kPrime32, 0x20CB8AB7AE10C14AULL },
+    };
+
+    const std::vector<uint8_t> buffer = sanityBuffer(256);
+    for (const Vector& vector : vectors) {
+        expectHash("sanity buffer", vector.size, vector.seed, vector.hash, hashBytes(buffer.data(), vector.size, vector.seed));
+
+        // Same bytes at an odd address, the stripes are read unaligned
+        std::vector<uint8_t> shifted(vector.size + 1);
+        std::memcpy(shifted.data() + 1, buffer.data(), vector.size);
+        expectHash("unaligned sanity buffer", vector.size, vector.seed, vector.hash, hashBytes(shifted.data() + 1, vector.size, vector.seed));
+    }
+
+    // Strings with published hashes
+    expectHash("\"a\"", 1, 0, 0xD24EC4F1A98C6E5BULL, hashBytes("a", 1));
+    expectHash("\"abc\"", 3, 0, 0x44BC2CF5AD770999ULL, hashBytes("abc", 3));
+    static const char sentence[] = "Nobody inspects the spammish repetition";
+    expectHash("sentence", sizeof(sentence) - 1, 0, 0xFBCEA83C8A378BF1ULL, hashBytes(sentence, sizeof(sentence) - 1));
+
+    if (failures != 0) {
+        std::cerr << failures << " mismatches against the XXH64 test vectors" << std::endl;
+        return 1;
+    }
+
+    std::cout << "hashBytes matches the XXH64 test vectors" << std::endl;
+    return 0;
+}
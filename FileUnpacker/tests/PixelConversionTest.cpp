@@ -0,0 +1,198 @@
+// PixelConversionTest.cpp : Checks the SIMD pixel kernels and frame bounds against the scalar reference.
+//
+
+#include "PixelConversion.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+static int failures = 0;
+
+// Written past the end of every output buffer, a kernel that spills overwrites it
+static const size_t kGuardSize = 32;
+static const uint8_t kGuardByte = 0xA5;
+
+using ConversionKernel = void(*)(const uint8_t*, size_t, const PaletteLUT&, uint8_t*);
+
+static std::vector<uint8_t> convert(ConversionKernel kernel, const std::vector<uint8_t>& indices, const PaletteLUT& lut) {
+    std::vector<uint8_t> out(indices.size() * 3 + kGuardSize, kGuardByte);
+    kernel(indices.data(), indices.size(), lut, out.data());
+    return out;
+}
+
+static void checkConversion(const std::vector<uint8_t>& indices, const PaletteLUT& lut) {
+    const std::vector<uint8_t> expected = convert(convertIndicesToBGRScalar, indices, lut);
+    const size_t outputSize = indices.size() * 3;
+
+    for (size_t i = outputSize; i < expected.size(); ++i) {
+        if (expected[i] != kGuardByte) {
+            ++failures;
+            std::cerr << "convertIndicesToBGRScalar (" << indices.size() << " pixels): wrote past the output" << std::endl;
+            return;
+        }
+    }
+
+    const struct { const char* name; ConversionKernel kernel; } kernels[] = {
+        { "convertIndicesToBGRAVX2", convertIndicesToBGRAVX2 },
+        { "convertIndicesToBGR", convertIndicesToBGR },
+    };
+    for (const auto& candidate : kernels) {
+        const std::vector<uint8_t> actual = convert(candidate.kernel, indices, lut);
+        size_t mismatch = 0;
+        while (mismatch < actual.size() && actual[mismatch] == expected[mismatch])
+            ++mismatch;
+        if (mismatch == actual.size())
+            continue;
+
+        ++failures;
+        std::cerr << candidate.name << " (" << indices.size() << " pixels): "
+            << (mismatch < outputSize ? "differs at byte " : "wrote past the output at byte ") << mismatch << std::endl;
+    }
+}
+
+// Straightforward pixel by pixel scan
+static FrameBounds referenceBounds(const std::vector<uint8_t>& indices, uint32_t width, uint32_t height) {
+    uint32_t left = width, top = height, right = 0, bottom = 0;
+    for (uint32_t y = 0; y < height; ++y) {
+        for (uint32_t x = 0; x < width; ++x) {
+            if (indices[static_cast<size_t>(y) * width + x] == 0)
+                continue;
+            left = std::min(left, x);
+            top = std::min(top, y);
+            right = std::max(right, x + 1);
+            bottom = std::max(bottom, y + 1);
+        }
+    }
+
+    FrameBounds bounds;
+    if (right == 0)
+        return bounds;
+    bounds.x = left;
+    bounds.y = top;
+    bounds.width = right - left;
+    bounds.height = bottom - top;
+    return bounds;
+}
+
+static void checkBounds(const std::vector<uint8_t>& indices, uint32_t width, uint32_t height) {
+    const FrameBounds expected = referenceBounds(indices, width, height);
+    const FrameBounds actual = findOpaqueBounds(indices.data(), width, height);
+    if (expected.x == actual.x && expected.y == actual.y && expected.width == actual.width && expected.height == actual.height)
+        return;
+
+    ++failures;
+    std::cerr << "findOpaqueBounds (" << width << " x " << height << "): expected "
+        << expected.width << " x " << expected.height << " at " << expected.x << ", " << expected.y << ", got "
+        << actual.width << " x " << actual.height << " at " << actual.x << ", " << actual.y << std::endl;
+}
+
+static void checkOpaqueScans(const std::vector<uint8_t>& row) {
+    const size_t first = findFirstOpaqueScalar(row.data(), row.size());
+    const size_t end = findOpaqueEndScalar(row.data(), row.size());
+    const size_t actualFirst = findFirstOpaqueSSE2(row.data(), row.size());
+    const size_t actualEnd = findOpaqueEndSSE2(row.data(), row.size());
+    if (actualFirst != first) {
+        ++failures;
+        std::cerr << "findFirstOpaqueSSE2 (" << row.size() << " pixels): expected " << first << ", got " << actualFirst << std::endl;
+    }
+    if (actualEnd != end) {
+        ++failures;
+        std::cerr << "findOpaqueEndSSE2 (" << row.size() << " pixels): expected " << end << ", got " << actualEnd << std::endl;
+    }
+}
+
+// Mostly transparent pixels, opaque ones spread at the given rate (out of 256)
+static std::vector<uint8_t> sparseFrame(std::mt19937& rng, size_t size, uint32_t opaqueRate) {
+    std::vector<uint8_t> indices(size, 0);
+    for (uint8_t& index : indices) {
+        if (rng() % 256 < opaqueRate)
+            index = static_cast<uint8_t>(1 + rng() % 255);
+    }
+    return indices;
+}
+
+static std::vector<uint8_t> randomBytes(std::mt19937& rng, size_t size) {
+    std::vector<uint8_t> bytes(size);
+    for (uint8_t& byte : bytes)
+        byte = static_cast<uint8_t>(rng() & 0xFF);
+    return bytes;
+}
+
+int main() {
+    std::mt19937 rng(20240601);
+
+    std::cout << "AVX2 kernels " << (cpuSupportsAVX2() ? "enabled" : "not supported, checking the fallback") << std::endl;
+
+    // Random colors, so a pixel read from the wrong index shows up
+    const std::vector<uint8_t> palette = randomBytes(rng, 256 * 3);
+    const PaletteLUT lut = buildPaletteLUT(palette);
+
+    // Tails shorter than a SIMD step and around the step size
+    for (size_t count = 0; count <= 64; ++count) {
+        for (int round = 0; round < 16; ++round)
+            checkConversion(randomBytes(rng, count), lut);
+    }
+
+    // Frame rows of typical and odd widths
+    for (int round = 0; round < 200; ++round)
+        checkConversion(randomBytes(rng, 65 + rng() % 8192), lut);
+
+    // Row scans around the SSE2 block size, with a single opaque pixel anywhere
+    for (size_t count = 0; count <= 48; ++count) {
+        std::vector<uint8_t> row(count, 0);
+        checkOpaqueScans(row);
+        for (size_t i = 0; i < count; ++i) {
+            row[i] = 1;
+            checkOpaqueScans(row);
+            row[i] = 0;
+        }
+        for (int round = 0; round < 16; ++round)
+            checkOpaqueScans(sparseFrame(rng, count, 8));
+    }
+
+    // Widths around 16 and 32, with frames that are empty, single pixels on the last
+    // column or row, and sparse
+    const uint32_t widths[] = { 1, 2, 15, 16, 17, 31, 32, 33, 47, 48, 49 };
+    for (uint32_t width : widths) {
+        for (uint32_t height = 1; height <= 5; ++height) {
+            const size_t size = static_cast<size_t>(width) * height;
+            checkBounds(std::vector<uint8_t>(size, 0), width, height);
+
+            for (uint32_t y = 0; y < height; ++y) {
+                std::vector<uint8_t> frame(size, 0);
+                frame[static_cast<size_t>(y) * width + width - 1] = 7;
+                checkBounds(frame, width, height);
+            }
+            for (uint32_t x = 0; x < width; ++x) {
+                std::vector<uint8_t> frame(size, 0);
+                frame[static_cast<size_t>(height - 1) * width + x] = 7;
+                checkBounds(frame, width, height);
+            }
+            for (int round = 0; round < 16; ++round)
+                checkBounds(sparseFrame(rng, size, 4), width, height);
+        }
+    }
+
+    // Single pixel frames
+    checkBounds({ 0 }, 1, 1);
+    checkBounds({ 9 }, 1, 1);
+
+    // Larger frames of random size
+    for (int round = 0; round < 200; ++round) {
+        const uint32_t width = 1 + rng() % 300;
+        const uint32_t height = 1 + rng() % 100;
+        checkBounds(sparseFrame(rng, static_cast<size_t>(width) * height, rng() % 3), width, height);
+    }
+
+    if (failures != 0) {
+        std::cerr << failures << " mismatches against the scalar reference" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All kernels match the scalar reference" << std::endl;
+    return 0;
+}
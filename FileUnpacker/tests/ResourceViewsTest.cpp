@@ -0,0 +1,135 @@
+// ResourceViewsTest.cpp : Checks that the resource views reject malformed headers.
+//
+
+#include "ResourceViews.h"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+static int failures = 0;
+
+static void expectSize(const char* what, uint64_t expected, uint64_t actual) {
+    if (expected == actual)
+        return;
+
+    ++failures;
+    std::cerr << what << ": expected " << expected << ", got " << actual << std::endl;
+}
+
+static void putLE16(std::vector<uint8_t>& data, size_t offset, uint16_t value) {
+    data[offset] = static_cast<uint8_t>(value);
+    data[offset + 1] = static_cast<uint8_t>(value >> 8);
+}
+
+static void putLE32(std::vector<uint8_t>& data, size_t offset, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i)
+        data[offset + i] = static_cast<uint8_t>(value >> (i * 8));
+}
+
+struct TestFrame {
+    uint32_t offset;    // From the end of the frame table
+    uint16_t width;
+    uint16_t height;
+};
+
+// D3GR resource with the given frame table, long enough to hold every frame header and its pixels
+static std::vector<uint8_t> buildD3GR(const std::vector<TestFrame>& frames, uint16_t count) {
+    const size_t tableEnd = D3GRView::kFrameTableOffset + static_cast<size_t>(count) * 4;
+    size_t size = tableEnd;
+    for (const TestFrame& frame : frames)
+        size = std::max(size, tableEnd + frame.offset + FrameView::kHeaderSize + static_cast<size_t>(frame.width) * frame.height);
+
+    std::vector<uint8_t> data(size, 0);
+    data[0] = 'D'; data[1] = '3'; data[2] = 'G'; data[3] = 'R';
+    putLE16(data, D3GRView::kFrameCountOffset, count);
+    for (size_t i = 0; i < frames.size() && i < count; ++i) {
+        putLE32(data, D3GRView::kFrameTableOffset + i * 4, frames[i].offset);
+        putLE16(data, tableEnd + frames[i].offset + FrameView::kHeightOffset, frames[i].height);
+        putLE16(data, tableEnd + frames[i].offset + FrameView::kWidthOffset, frames[i].width);
+    }
+    return data;
+}
+
+static std::vector<uint8_t> buildD3GR(const std::vector<TestFrame>& frames) {
+    return buildD3GR(frames, static_cast<uint16_t>(frames.size()));
+}
+
+// measure and the view go through the same frame table check and must agree on it
+static void checkD3GR(const char* what, const std::vector<uint8_t>& data, uint32_t expectedSize) {
+    const auto bytes = asBytes(data.data(), data.size());
+    expectSize(what, expectedSize, D3GRView::measure(bytes));
+
+    D3GRView view(bytes);
+    if (view.isValid() != (expectedSize != 0)) {
+        ++failures;
+        std::cerr << what << ": view is " << (view.isValid() ? "valid" : "invalid") << std::endl;
+    }
+}
+
+static std::vector<uint8_t> buildRiffHeader(uint32_t riffSize) {
+    std::vector<uint8_t> data(WavView::kHeaderSize, 0);
+    data[0] = 'R'; data[1] = 'I'; data[2] = 'F'; data[3] = 'F';
+    putLE32(data, 4, riffSize);
+    return data;
+}
+
+static uint32_t measureWav(const std::vector<uint8_t>& data) {
+    return WavView::measure(asBytes(data.data(), data.size()));
+}
+
+int main() {
+    // Frame tables that are fine
+    const size_t oneFrameTable = D3GRView::kFrameTableOffset + 4;
+    checkD3GR("single frame", buildD3GR({ { 0, 3, 2 } }), static_cast<uint32_t>(oneFrameTable + FrameView::kHeaderSize + 6));
+    checkD3GR("empty frame", buildD3GR({ { 0, 0, 0 } }), static_cast<uint32_t>(oneFrameTable + FrameView::kHeaderSize));
+    checkD3GR("frames in order", buildD3GR({ { 0, 2, 2 }, { 20, 4, 1 } }),
+        static_cast<uint32_t>(D3GRView::kFrameTableOffset + 8 + 20 + FrameView::kHeaderSize + 4));
+    checkD3GR("frame listed twice", buildD3GR({ { 0, 2, 2 }, { 0, 2, 2 } }),
+        static_cast<uint32_t>(D3GRView::kFrameTableOffset + 8 + FrameView::kHeaderSize + 4));
+    checkD3GR("largest frame", buildD3GR({ { 0, D3GRView::kMaxFrameDimension, 1 } }),
+        static_cast<uint32_t>(oneFrameTable + FrameView::kHeaderSize + D3GRView::kMaxFrameDimension));
+
+    // No frames at all
+    checkD3GR("zero frames", buildD3GR({}), 0);
+
+    // Entries pointing past the data
+    std::vector<uint8_t> outOfRange = buildD3GR({ { 0, 2, 2 } });
+    putLE32(outOfRange, D3GRView::kFrameTableOffset, 1000);
+    checkD3GR("entry past the data", outOfRange, 0);
+    std::vector<uint8_t> wrapping = buildD3GR({ { 0, 2, 2 } });
+    putLE32(wrapping, D3GRView::kFrameTableOffset, UINT32_MAX);
+    checkD3GR("entry near 4 GiB", wrapping, 0);
+    std::vector<uint8_t> shortTable = buildD3GR({ { 0, 2, 2 } });
+    putLE16(shortTable, D3GRView::kFrameCountOffset, 500);
+    checkD3GR("table longer than the data", shortTable, 0);
+
+    // Frames running into each other or going backwards
+    checkD3GR("overlapping frames", buildD3GR({ { 0, 4, 4 }, { 8, 2, 2 } }), 0);
+    checkD3GR("frames out of order", buildD3GR({ { 40, 2, 2 }, { 0, 2, 2 } }), 0);
+
+    // Sides larger than any real frame
+    checkD3GR("oversized width", buildD3GR({ { 0, D3GRView::kMaxFrameDimension + 1, 1 } }), 0);
+    checkD3GR("oversized height", buildD3GR({ { 0, 1, D3GRView::kMaxFrameDimension + 1 } }), 0);
+
+    // Headers too short to read the table from
+    std::vector<uint8_t> truncated = buildD3GR({ { 0, 2, 2 } });
+    truncated.resize(D3GRView::kFrameTableOffset - 1);
+    checkD3GR("cut before the table", truncated, 0);
+
+    // RIFF sizes near the top of the 32-bit range
+    expectSize("RIFF size 0", WavView::kHeaderSize, measureWav(buildRiffHeader(0)));
+    expectSize("RIFF size 1000", 1000 + WavView::kHeaderSize, measureWav(buildRiffHeader(1000)));
+    expectSize("largest RIFF size", UINT32_MAX, measureWav(buildRiffHeader(UINT32_MAX - WavView::kHeaderSize)));
+    expectSize("RIFF size past 4 GiB", 0, measureWav(buildRiffHeader(UINT32_MAX - WavView::kHeaderSize + 1)));
+    expectSize("RIFF size 0xFFFFFFFF", 0, measureWav(buildRiffHeader(UINT32_MAX)));
+    expectSize("short RIFF header", 0, measureWav(std::vector<uint8_t>(WavView::kHeaderSize - 1, 0)));
+
+    if (failures != 0) {
+        std::cerr << failures << " unexpected results" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Malformed headers are rejected" << std::endl;
+    return 0;
+}
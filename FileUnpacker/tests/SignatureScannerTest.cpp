@@ -0,0 +1,152 @@
+﻿// SignatureScannerTest.cpp : Checks the SIMD signature kernels against the scalar reference.
+//
+
+#include "SignatureScanner.h"
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static int failures = 0;
+
+static void expectSame(const char* what, size_t bufferSize, size_t expected, size_t actual) {
+    if (expected == actual)
+        return;
+
+    ++failures;
+    std::cerr << what << " (" << bufferSize << " bytes): expected " << static_cast<long long>(expected)
+        << ", got " << static_cast<long long>(actual) << std::endl;
+}
+
+// Bytes that make up the signatures, so random data hits the anchors often
+static const char kSignatureBytes[] = "RIFFWAVEfmt D3GR\x00\xFF";
+
+static std::vector<char> randomBuffer(std::mt19937& rng, size_t size, bool signatureBytes) {
+    std::vector<char> buffer(size);
+    for (char& byte : buffer) {
+        byte = signatureBytes
+            ? kSignatureBytes[rng() % (sizeof(kSignatureBytes) - 1)]
+            : static_cast<char>(rng() & 0xFF);
+    }
+    return buffer;
+}
+
+static void plant(std::vector<char>& buffer, size_t offset, const char* bytes, size_t length) {
+    if (offset + length <= buffer.size())
+        std::memcpy(buffer.data() + offset, bytes, length);
+    else if (offset < buffer.size())
+        std::memcpy(buffer.data() + offset, bytes, buffer.size() - offset);  // Cut off by the end of the buffer
+}
+
+static void plantSignatures(std::mt19937& rng, std::vector<char>& buffer) {
+    static const char wav[] = "RIFF\x12\x34\x56\x78WAVEfmt ";
+    static const char graphics[] = "D3GR";
+
+    if (buffer.empty())
+        return;
+
+    size_t count = 1 + rng() % 3;
+    for (size_t i = 0; i < count; ++i) {
+        if (rng() % 2)
+            plant(buffer, rng() % buffer.size(), wav, sizeof(wav) - 1);
+        else
+            plant(buffer, rng() % buffer.size(), graphics, sizeof(graphics) - 1);
+    }
+}
+
+// The kernels may read up to secondOffset bytes past the last position
+static void checkCandidateKernels(const std::vector<char>& buffer) {
+    const ScanAnchor anchors[] = { kWavSignature.anchor, kGraphicsResourceSignature.anchor };
+    const size_t maxOffset = std::max(kWavSignature.anchor.secondOffset, kGraphicsResourceSignature.anchor.secondOffset);
+
+    for (const ScanAnchor& anchor : anchors) {
+        if (buffer.size() <= anchor.secondOffset)
+            continue;
+
+        size_t positions = buffer.size() - anchor.secondOffset;
+        size_t expected = findCandidateScalar(buffer.data(), positions, anchor.first, anchor.secondOffset, anchor.second);
+        expectSame("findCandidateSSE2", buffer.size(), expected,
+            findCandidateSSE2(buffer.data(), positions, anchor.first, anchor.secondOffset, anchor.second));
+        expectSame("findCandidateAVX2", buffer.size(), expected,
+            findCandidateAVX2(buffer.data(), positions, anchor.first, anchor.secondOffset, anchor.second));
+        expectSame("findCandidate", buffer.size(), expected,
+            findCandidate(buffer.data(), positions, anchor.first, anchor.secondOffset, anchor.second));
+    }
+
+    if (buffer.size() <= maxOffset)
+        return;
+
+    size_t positions = buffer.size() - maxOffset;
+    size_t expected = findAnyCandidateScalar(buffer.data(), positions, anchors, 2);
+    expectSame("findAnyCandidateSSE2", buffer.size(), expected, findAnyCandidateSSE2(buffer.data(), positions, anchors, 2));
+    expectSame("findAnyCandidateAVX2", buffer.size(), expected, findAnyCandidateAVX2(buffer.data(), positions, anchors, 2));
+    expectSame("findAnyCandidate", buffer.size(), expected, findAnyCandidate(buffer.data(), positions, anchors, 2));
+}
+
+static void checkHeaderFinders(const std::vector<char>& buffer) {
+    const char* data = buffer.data();
+    const size_t size = buffer.size();
+
+    size_t wav = findWavHeaderScalar(data, size);
+    size_t graphics = findGraphicsResourceHeaderScalar(data, size);
+    expectSame("findWavHeader", size, wav, findWavHeader(data, size));
+    expectSame("findGraphicsResourceHeader", size, graphics, findGraphicsResourceHeader(data, size));
+
+    // The combined scan reports the earlier of the two headers
+    static const SignatureSet set = buildSignatureSet({ kWavSignature, kGraphicsResourceSignature });
+    size_t patternIndex = SIZE_MAX;
+    expectSame("findNextSignature", size, std::min(wav, graphics), findNextSignature(set, data, size, patternIndex));
+}
+
+int main() {
+    std::mt19937 rng(20240601);
+
+    std::cout << "AVX2 kernels " << (cpuSupportsAVX2() ? "enabled" : "not supported, checking the fallback") << std::endl;
+
+    // Tails shorter than the signatures and around the SIMD block sizes
+    for (size_t size = 0; size <= 80; ++size) {
+        for (int round = 0; round < 64; ++round) {
+            std::vector<char> buffer = randomBuffer(rng, size, true);
+            if (round % 2)
+                plantSignatures(rng, buffer);
+            checkCandidateKernels(buffer);
+            checkHeaderFinders(buffer);
+        }
+    }
+
+    // Signatures right at the end of the buffer, including ones cut short by it
+    for (size_t size = 1; size <= 64; ++size) {
+        for (size_t offset = 0; offset < size; ++offset) {
+            std::vector<char> buffer(size, 'x');
+            plant(buffer, offset, "RIFF\0\0\0\0WAVEfmt ", 16);
+            checkHeaderFinders(buffer);
+
+            std::fill(buffer.begin(), buffer.end(), 'x');
+            plant(buffer, offset, "D3GR", 4);
+            checkCandidateKernels(buffer);
+            checkHeaderFinders(buffer);
+        }
+    }
+
+    // Larger buffers, with plain random data and with planted headers
+    for (int round = 0; round < 200; ++round) {
+        size_t size = 64 + rng() % 8192;
+        std::vector<char> buffer = randomBuffer(rng, size, round % 2 == 0);
+        if (round % 4 < 2)
+            plantSignatures(rng, buffer);
+        checkCandidateKernels(buffer);
+        checkHeaderFinders(buffer);
+    }
+
+    if (failures != 0) {
+        std::cerr << failures << " mismatches against the scalar reference" << std::endl;
+        return 1;
+    }
+
+    std::cout << "All kernels match the scalar reference" << std::endl;
+    return 0;
+}
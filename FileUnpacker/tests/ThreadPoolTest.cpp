@@ -0,0 +1,99 @@
+// ThreadPoolTest.cpp : Stress test of task groups waited on with and without a limit, and nested waits.
+//
+
+#include "ThreadPool.h"
+
+#include <atomic>
+#include <iostream>
+
+static int failures = 0;
+
+static void expectEqual(const char* what, size_t expected, size_t actual) {
+    if (expected == actual)
+        return;
+
+    ++failures;
+    std::cerr << what << ": expected " << expected << ", got " << actual << std::endl;
+}
+
+// Short lived groups on the stack, waited on with a limit first like the pipeline's scan does
+static void limitedWaits(ThreadPool& pool, size_t rounds) {
+    for (size_t round = 0; round < rounds; ++round) {
+        std::atomic<size_t> done{ 0 };
+        TaskGroup group;
+        const size_t taskCount = 1 + round % 40;
+        for (size_t i = 0; i < taskCount; ++i) {
+            pool.submit(group, [&done] { done.fetch_add(1); });
+            if (i % 8 == 7) {
+                pool.wait(group, 1 + round % 4);
+            }
+        }
+        pool.wait(group, 2);
+        pool.wait(group);
+        expectEqual("Tasks of a group run before wait returns", taskCount, done.load());
+    }
+}
+
+// Top level tasks waiting for nested work must not pick up another top level task meanwhile
+static void nestedWaits(ThreadPool& pool) {
+    static thread_local int topLevelDepth = 0;
+    std::atomic<int> deepest{ 0 };
+    std::atomic<size_t> nested{ 0 };
+
+    TaskGroup topLevel;
+    for (int i = 0; i < 64; ++i) {
+        pool.submit(topLevel, [&] {
+            ++topLevelDepth;
+            int depth = topLevelDepth;
+            int seen = deepest.load();
+            while (depth > seen && !deepest.compare_exchange_weak(seen, depth)) {
+            }
+
+            TaskGroup inner;
+            for (int j = 0; j < 32; ++j) {
+                pool.submit(inner, [&nested] { nested.fetch_add(1); });
+                pool.wait(inner, 4);
+            }
+            pool.wait(inner);
+            --topLevelDepth;
+            });
+    }
+    pool.wait(topLevel);
+
+    expectEqual("Nested tasks of every top level task run", 64 * 32, nested.load());
+    expectEqual("Top level tasks never nest while waiting", 1, static_cast<size_t>(deepest.load()));
+}
+
+int main() {
+    ThreadPool pool(8);
+    std::cout << "Pool of " << pool.threadCount() << " threads" << std::endl;
+
+    limitedWaits(pool, 20000);
+
+    // The same from inside tasks, with nested parallelFor groups
+    TaskGroup outer;
+    std::atomic<size_t> chunks{ 0 };
+    for (int i = 0; i < 16; ++i) {
+        pool.submit(outer, [&] {
+            limitedWaits(pool, 500);
+            pool.parallelFor(100, 3, [&](size_t begin, size_t end) { chunks.fetch_add(end - begin); });
+            });
+    }
+    pool.wait(outer);
+    expectEqual("parallelFor covers every index", 16 * 100, chunks.load());
+
+    nestedWaits(pool);
+
+    // A pool of one thread runs every task on the waiting thread
+    ThreadPool single(1);
+    limitedWaits(single, 2000);
+    nestedWaits(single);
+
+    if (failures != 0) {
+        std::cerr << failures << " thread pool checks failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Thread pool checks passed" << std::endl;
+    return 0;
+}